@@ -0,0 +1,254 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#include "CborListener.h"
+
+#define CBOR_MAJOR_UNSIGNED      0
+#define CBOR_MAJOR_NEGATIVE      1
+#define CBOR_MAJOR_TEXT          3
+#define CBOR_MAJOR_ARRAY         4
+#define CBOR_MAJOR_MAP           5
+
+#define CBOR_FALSE               0xf4
+#define CBOR_TRUE                0xf5
+#define CBOR_NULL                0xf6
+#define CBOR_HALF                0xf9
+#define CBOR_FLOAT               0xfa
+#define CBOR_DOUBLE              0xfb
+#define CBOR_BREAK               0xff
+#define CBOR_INDEFINITE          31
+
+CborListener::CborListener(Print* output) {
+  this->output = output;
+}
+
+void CborListener::flush() {
+  if (bufferPos > 0) {
+    output->write(buffer, bufferPos);
+    bufferPos = 0;
+  }
+}
+
+unsigned long CborListener::getBytesWritten() {
+  return bytesWritten;
+}
+
+void CborListener::writeByte(uint8_t b) {
+  if (bufferPos == CBOR_BUFFER_LENGTH) {
+    flush();
+  }
+  buffer[bufferPos] = b;
+  bufferPos++;
+  bytesWritten++;
+}
+
+void CborListener::writeBytes(const uint8_t *data, size_t length) {
+  if (length >= CBOR_BUFFER_LENGTH) {
+    // large strings bypass the buffer
+    flush();
+    output->write(data, length);
+    bytesWritten += length;
+    return;
+  }
+  for (size_t i = 0; i < length; i++) {
+    writeByte(data[i]);
+  }
+}
+
+void CborListener::writeHead(uint8_t majorType, uint64_t argument) {
+  uint8_t major = majorType << 5;
+  if (argument < 24) {
+    writeByte(major | (uint8_t) argument);
+  } else if (argument <= 0xff) {
+    writeByte(major | 24);
+    writeByte((uint8_t) argument);
+  } else if (argument <= 0xffff) {
+    writeByte(major | 25);
+    writeByte((uint8_t) (argument >> 8));
+    writeByte((uint8_t) argument);
+  } else if (argument <= 0xffffffffUL) {
+    writeByte(major | 26);
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      writeByte((uint8_t) (argument >> shift));
+    }
+  } else {
+    writeByte(major | 27);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      writeByte((uint8_t) (argument >> shift));
+    }
+  }
+}
+
+void CborListener::writeString(const char *value) {
+  size_t length = strlen(value);
+  writeHead(CBOR_MAJOR_TEXT, length);
+  writeBytes((const uint8_t *) value, length);
+}
+
+boolean CborListener::parseInteger(const char *value, uint64_t *magnitude, boolean *negative) {
+  const char *c = value;
+  *negative = (*c == '-');
+  if (*negative) {
+    c++;
+  }
+  uint64_t result = 0;
+  for (; *c != '\0'; c++) {
+    if (*c < '0' || *c > '9') {
+      // fraction or exponent
+      return false;
+    }
+    uint64_t digit = *c - '0';
+    if (result > (UINT64_MAX - digit) / 10) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+  if (*negative && result == 0) {
+    // -0 is just 0 for integers
+    *negative = false;
+  }
+  *magnitude = result;
+  return true;
+}
+
+void CborListener::writeNumber(const char *value) {
+  uint64_t magnitude;
+  boolean negative;
+  if (parseInteger(value, &magnitude, &negative)) {
+    if (!negative) {
+      writeHead(CBOR_MAJOR_UNSIGNED, magnitude);
+      return;
+    }
+    // CBOR negative integers encode -1 - n
+    writeHead(CBOR_MAJOR_NEGATIVE, magnitude - 1);
+    return;
+  }
+  writeFloat(strtod(value, NULL));
+}
+
+void CborListener::writeFloat(double number) {
+  float single = (float) number;
+  if ((double) single != number && number == number && sizeof(double) == sizeof(uint64_t)) {
+    uint64_t bits;
+    memcpy(&bits, &number, sizeof(bits));
+    writeByte(CBOR_DOUBLE);
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      writeByte((uint8_t) (bits >> shift));
+    }
+    return;
+  }
+
+  uint32_t bits;
+  memcpy(&bits, &single, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  int exponent = (int) ((bits >> 23) & 0xff) - 127;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  // use half precision if no bits get lost on the way
+  boolean isHalf = false;
+  uint16_t half = 0;
+  if (exponent == -127 && mantissa == 0) {
+    // zero
+    isHalf = true;
+    half = sign;
+  } else if (exponent == 128) {
+    // infinity and NaN
+    isHalf = (mantissa & 0x1fff) == 0;
+    half = sign | 0x7c00 | (mantissa >> 13);
+  } else if (exponent >= -14 && exponent <= 15) {
+    isHalf = (mantissa & 0x1fff) == 0;
+    half = sign | ((exponent + 15) << 10) | (mantissa >> 13);
+  } else if (exponent >= -24 && exponent < -14) {
+    // subnormal half
+    int shift = 13 + (-14 - exponent);
+    uint32_t full = mantissa | 0x800000;
+    isHalf = (full & ((1UL << shift) - 1)) == 0;
+    half = sign | (full >> shift);
+  }
+
+  if (isHalf) {
+    writeByte(CBOR_HALF);
+    writeByte((uint8_t) (half >> 8));
+    writeByte((uint8_t) half);
+    return;
+  }
+  writeByte(CBOR_FLOAT);
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    writeByte((uint8_t) (bits >> shift));
+  }
+}
+
+void CborListener::whitespace(char c) {
+}
+
+void CborListener::startDocument() {
+  bytesWritten = 0;
+}
+
+void CborListener::key(const char *key) {
+  writeString(key);
+}
+
+void CborListener::value(const char *value) {
+  writeString(value);
+}
+
+void CborListener::typedValue(const char *value, int type) {
+  if (type == VALUE_TYPE_NUMBER) {
+    writeNumber(value);
+  } else if (type == VALUE_TYPE_TRUE) {
+    writeByte(CBOR_TRUE);
+  } else if (type == VALUE_TYPE_FALSE) {
+    writeByte(CBOR_FALSE);
+  } else if (type == VALUE_TYPE_NULL) {
+    writeByte(CBOR_NULL);
+  } else {
+    writeString(value);
+  }
+}
+
+void CborListener::endArray() {
+  writeByte(CBOR_BREAK);
+}
+
+void CborListener::endObject() {
+  writeByte(CBOR_BREAK);
+}
+
+void CborListener::endDocument() {
+  flush();
+}
+
+void CborListener::startArray() {
+  writeByte((CBOR_MAJOR_ARRAY << 5) | CBOR_INDEFINITE);
+}
+
+void CborListener::startObject() {
+  writeByte((CBOR_MAJOR_MAP << 5) | CBOR_INDEFINITE);
+}
+
+void CborListener::error( const char *message ) {
+  flush();
+}
@@ -0,0 +1,97 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "MockArduino.h"
+#endif
+#include "JsonListener.h"
+
+#define CBOR_BUFFER_LENGTH  64
+
+/**
+ * Listener that transcodes the parser events to CBOR (RFC 7049) on the fly
+ * and writes the result to any Print (Serial, a WiFiClient, a File, ...).
+ * Objects and arrays are written as indefinite-length containers, so nothing
+ * but a small output buffer is kept in memory. Numbers are written in the
+ * smallest integer or float form that represents them exactly.
+ */
+class CborListener: public JsonListener {
+  private:
+    Print* output;
+
+    uint8_t buffer[CBOR_BUFFER_LENGTH];
+    int bufferPos = 0;
+
+    unsigned long bytesWritten = 0;
+
+    void writeByte(uint8_t b);
+
+    void writeBytes(const uint8_t *data, size_t length);
+
+    void writeHead(uint8_t majorType, uint64_t argument);
+
+    void writeString(const char *value);
+
+    void writeNumber(const char *value);
+
+    void writeFloat(double number);
+
+    boolean parseInteger(const char *value, uint64_t *magnitude, boolean *negative);
+
+  public:
+    CborListener(Print* output);
+
+    // Hands the buffered bytes to the output. Called at the end of the document.
+    void flush();
+
+    // Total number of CBOR bytes produced so far
+    unsigned long getBytesWritten();
+
+    virtual void whitespace(char c);
+
+    virtual void startDocument();
+
+    virtual void key(const char *key);
+
+    virtual void value(const char *value);
+
+    virtual void typedValue(const char *value, int type);
+
+    virtual void endArray();
+
+    virtual void endObject();
+
+    virtual void endDocument();
+
+    virtual void startArray();
+
+    virtual void startObject();
+
+    virtual void error( const char *message );
+};
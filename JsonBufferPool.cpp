@@ -0,0 +1,74 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#include "JsonBufferPool.h"
+
+JsonBufferPool::JsonBufferPool(char *storage, int blockLength, int blockCount) {
+  this->blockLength = blockLength;
+  scratch = storage;
+  for (int i = 1; i < blockCount; i++) {
+    release(storage + i * blockLength);
+  }
+}
+
+char *JsonBufferPool::acquireScratch() {
+  if (scratchInUse) {
+    return acquire();
+  }
+  scratchInUse = true;
+  return scratch;
+}
+
+char *JsonBufferPool::acquire() {
+  char *block = freeList;
+  if (block != NULL) {
+    // free blocks keep the pointer to the next free block in their first bytes
+    memcpy(&freeList, block, sizeof(freeList));
+    freeBlocks--;
+  }
+  return block;
+}
+
+void JsonBufferPool::release(char *block) {
+  if (block == scratch) {
+    scratchInUse = false;
+    return;
+  }
+  memcpy(block, &freeList, sizeof(freeList));
+  freeList = block;
+  freeBlocks++;
+}
+
+boolean JsonBufferPool::isScratch(const char *block) {
+  return block == scratch;
+}
+
+int JsonBufferPool::getBlockLength() {
+  return blockLength;
+}
+
+int JsonBufferPool::getFreeBlocks() {
+  return freeBlocks;
+}
@@ -0,0 +1,72 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "MockArduino.h"
+#endif
+
+/**
+ * Hands out fixed size token buffers from memory provided by the caller.
+ * A JsonPooledParser reads every token into the pool's scratch buffer and
+ * only moves it to a side block of its own if the token continues in the
+ * next parse() call, so many mostly idle parsers (e.g. one per open
+ * connection) can share a few buffers. A pool must only be used from one
+ * thread; give every thread its own pool.
+ */
+class JsonBufferPool {
+  private:
+    char *freeList = NULL;
+    char *scratch;
+    int blockLength;
+    int freeBlocks = 0;
+    boolean scratchInUse = false;
+
+  public:
+    // storage must hold blockLength * blockCount bytes, blockLength must be
+    // at least 8 and leaves room for blockLength - 1 characters per token.
+    // The first block is the scratch buffer, the others are side blocks.
+    JsonBufferPool(char *storage, int blockLength, int blockCount);
+
+    // Returns the scratch buffer, or a side block if another parser is
+    // reading into it (e.g. one that is fed from a listener)
+    char *acquireScratch();
+
+    // Returns a side block, NULL if all are in use
+    char *acquire();
+
+    // Takes back a side block or the scratch buffer
+    void release(char *block);
+
+    boolean isScratch(const char *block);
+
+    int getBlockLength();
+
+    // Number of side blocks not in use
+    int getFreeBlocks();
+};
@@ -0,0 +1,223 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#include "JsonColumnExtractor.h"
+#include <errno.h>
+
+// records are the objects directly inside the top-level array
+#define RECORD_DEPTH             2
+
+JsonColumnExtractor::JsonColumnExtractor(JsonColumn columns[], int columnCount, int batchSize,
+                                         JsonBatchCallback callback, void *context) {
+  this->columns = columns;
+  this->columnCount = columnCount;
+  this->batchSize = batchSize;
+  this->callback = callback;
+  this->context = context;
+  valid = batchSize > 0 && callback != NULL;
+  for (int i = 0; i < columnCount && valid; i++) {
+    valid = isValidColumn(&columns[i]);
+  }
+  if (valid) {
+    clearBatch();
+  }
+}
+
+boolean JsonColumnExtractor::isValidColumn(JsonColumn *column) {
+  if (column->path == NULL || strlen(column->path) >= COLUMN_PATH_MAX_LENGTH) {
+    return false;
+  }
+  if (column->type > COLUMN_TYPE_STRING || column->values == NULL || column->present == NULL) {
+    return false;
+  }
+  // a string slot needs at least room for the terminating '\0'
+  return column->type != COLUMN_TYPE_STRING || column->width > 0;
+}
+
+boolean JsonColumnExtractor::isValid() {
+  return valid;
+}
+
+void JsonColumnExtractor::clearBatch() {
+  for (int i = 0; i < columnCount; i++) {
+    memset(columns[i].present, 0, (batchSize + 7) / 8);
+  }
+  row = 0;
+}
+
+void JsonColumnExtractor::flush() {
+  if (!valid) {
+    return;
+  }
+  if (row > 0) {
+    callback(columns, columnCount, row, context);
+  }
+  clearBatch();
+}
+
+int JsonColumnExtractor::findColumn() {
+  if (nextColumn < columnCount && strcmp(columns[nextColumn].path, path) == 0) {
+    return nextColumn;
+  }
+  for (int i = 0; i < columnCount; i++) {
+    if (strcmp(columns[i].path, path) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void JsonColumnExtractor::store(JsonColumn *column, const char *value, int type) {
+  if (column->type == COLUMN_TYPE_LONG && type == VALUE_TYPE_NUMBER) {
+    // fractions, exponents and numbers out of range are not longs
+    char *end;
+    errno = 0;
+    long number = strtol(value, &end, 10);
+    if (*end != '\0' || errno == ERANGE) {
+      return;
+    }
+    ((long *) column->values)[row] = number;
+  } else if (column->type == COLUMN_TYPE_DOUBLE && type == VALUE_TYPE_NUMBER) {
+    ((double *) column->values)[row] = strtod(value, NULL);
+  } else if (column->type == COLUMN_TYPE_BOOLEAN && (type == VALUE_TYPE_TRUE || type == VALUE_TYPE_FALSE)) {
+    ((boolean *) column->values)[row] = type == VALUE_TYPE_TRUE;
+  } else if (column->type == COLUMN_TYPE_STRING && type == VALUE_TYPE_STRING) {
+    char *slot = (char *) column->values + row * column->width;
+    strncpy(slot, value, column->width - 1);
+    slot[column->width - 1] = '\0';
+  } else {
+    return;
+  }
+  column->present[row >> 3] |= 1 << (row & 7);
+}
+
+void JsonColumnExtractor::whitespace(char c) {
+}
+
+void JsonColumnExtractor::startDocument() {
+  depth = 0;
+  skipDepth = 0;
+  inRecordArray = false;
+  inRecord = false;
+  if (valid) {
+    clearBatch();
+  }
+}
+
+void JsonColumnExtractor::key(const char *key) {
+  currentColumn = -1;
+  if (!inRecord || skipDepth > 0) {
+    return;
+  }
+  int length = pathLength[depth - RECORD_DEPTH];
+  if (length < 0) {
+    // parent path did not fit
+    keyPathLength = -1;
+    return;
+  }
+  if (length > 0) {
+    path[length] = '.';
+    length++;
+  }
+  int keyLength = strlen(key);
+  if (length + keyLength >= COLUMN_PATH_MAX_LENGTH) {
+    keyPathLength = -1;
+    return;
+  }
+  memcpy(path + length, key, keyLength + 1);
+  keyPathLength = length + keyLength;
+  currentColumn = findColumn();
+  if (currentColumn >= 0) {
+    nextColumn = currentColumn + 1;
+  }
+}
+
+void JsonColumnExtractor::value(const char *value) {
+  typedValue(value, VALUE_TYPE_STRING);
+}
+
+void JsonColumnExtractor::typedValue(const char *value, int type) {
+  if (!inRecord || skipDepth > 0 || currentColumn < 0) {
+    return;
+  }
+  store(&columns[currentColumn], value, type);
+  currentColumn = -1;
+}
+
+void JsonColumnExtractor::endArray() {
+  if (skipDepth == depth) {
+    skipDepth = 0;
+  }
+  depth--;
+  currentColumn = -1;
+}
+
+void JsonColumnExtractor::endObject() {
+  if (skipDepth == depth) {
+    skipDepth = 0;
+  }
+  if (inRecord && depth == RECORD_DEPTH) {
+    inRecord = false;
+    row++;
+    if (row == batchSize) {
+      flush();
+    }
+  }
+  depth--;
+  currentColumn = -1;
+}
+
+void JsonColumnExtractor::endDocument() {
+  flush();
+}
+
+void JsonColumnExtractor::startArray() {
+  depth++;
+  if (depth == RECORD_DEPTH - 1) {
+    inRecordArray = true;
+  } else if (inRecord && skipDepth == 0) {
+    skipDepth = depth;
+  }
+  currentColumn = -1;
+}
+
+void JsonColumnExtractor::startObject() {
+  depth++;
+  if (!inRecord && depth == RECORD_DEPTH && inRecordArray && valid) {
+    inRecord = true;
+    pathLength[0] = 0;
+    nextColumn = 0;
+  } else if (inRecord && skipDepth == 0) {
+    if (depth - RECORD_DEPTH < STACK_MAX_LENGTH) {
+      pathLength[depth - RECORD_DEPTH] = keyPathLength;
+    } else {
+      skipDepth = depth;
+    }
+  }
+  currentColumn = -1;
+}
+
+void JsonColumnExtractor::error( const char *message ) {
+}
@@ -0,0 +1,137 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "MockArduino.h"
+#endif
+#include "JsonListener.h"
+#include "JsonStreamingParser.h"
+
+#define COLUMN_TYPE_LONG         0
+#define COLUMN_TYPE_DOUBLE       1
+#define COLUMN_TYPE_BOOLEAN      2
+#define COLUMN_TYPE_STRING       3
+
+#define COLUMN_PATH_MAX_LENGTH   64
+
+struct JsonColumn {
+  // key of the field within a record, nested objects separated by '.',
+  // e.g. "position.lat"
+  const char *path;
+  uint8_t type;
+  // batchSize entries of long, double, boolean or, for strings, batchSize
+  // slots of width bytes each
+  void *values;
+  int width;
+  // (batchSize + 7) / 8 bytes, bit n is set if row n has a value. Missing
+  // fields, null and values of the wrong type leave the bit cleared.
+  uint8_t *present;
+};
+
+typedef void (*JsonBatchCallback)(JsonColumn columns[], int columnCount, int rows, void *context);
+
+/**
+ * Listener that reads an array of records (objects) into column buffers
+ * provided by the caller, batchSize rows at a time, and hands every full
+ * batch to the callback. Fields which are not listed as a column and
+ * arrays within records are skipped; nothing is allocated while parsing.
+ */
+class JsonColumnExtractor: public JsonListener {
+  private:
+    JsonColumn *columns;
+    int columnCount;
+    int batchSize;
+    JsonBatchCallback callback;
+    void *context;
+
+    int row = 0;
+    int depth = 0;
+    // depth of the array inside a record being skipped, 0 if none
+    int skipDepth = 0;
+    boolean inRecordArray = false;
+    boolean inRecord = false;
+
+    // path of the current key within the record, and the length of the
+    // path prefix for every nested object
+    char path[COLUMN_PATH_MAX_LENGTH];
+    int pathLength[STACK_MAX_LENGTH];
+    int keyPathLength = 0;
+
+    int currentColumn = -1;
+    // records usually list their fields in the same order, so the column
+    // after the last match is tried first
+    int nextColumn = 0;
+
+    // false if the column specs or the batch size are unusable
+    boolean valid;
+
+    boolean isValidColumn(JsonColumn *column);
+
+    void clearBatch();
+
+    int findColumn();
+
+    void store(JsonColumn *column, const char *value, int type);
+
+  public:
+    JsonColumnExtractor(JsonColumn columns[], int columnCount, int batchSize,
+                        JsonBatchCallback callback, void *context);
+
+    // False if batchSize is not positive, callback is NULL or a column has
+    // no path, a path longer than COLUMN_PATH_MAX_LENGTH - 1, an unknown
+    // type, no buffers or (for strings) a width below 1. Such an extractor
+    // ignores the document.
+    boolean isValid();
+
+    // Hands a partially filled batch to the callback. Called at the end of
+    // the document.
+    void flush();
+
+    virtual void whitespace(char c);
+
+    virtual void startDocument();
+
+    virtual void key(const char *key);
+
+    virtual void value(const char *value);
+
+    virtual void typedValue(const char *value, int type);
+
+    virtual void endArray();
+
+    virtual void endObject();
+
+    virtual void endDocument();
+
+    virtual void startArray();
+
+    virtual void startObject();
+
+    virtual void error( const char *message );
+};
@@ -0,0 +1,339 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#include "JsonEventRing.h"
+
+// type byte, flag byte and two length bytes
+#define RECORD_HEADER_LENGTH     4
+
+#if defined(ESP32)
+
+JsonRingSignal::JsonRingSignal() {
+  semaphore = xSemaphoreCreateBinary();
+}
+
+JsonRingSignal::~JsonRingSignal() {
+  vSemaphoreDelete(semaphore);
+}
+
+void JsonRingSignal::wait() {
+  xSemaphoreTake(semaphore, pdMS_TO_TICKS(RING_PARK_MS));
+}
+
+void JsonRingSignal::wake() {
+  xSemaphoreGive(semaphore);
+}
+
+#elif !defined(ARDUINO)
+
+JsonRingSignal::JsonRingSignal() {
+}
+
+JsonRingSignal::~JsonRingSignal() {
+}
+
+void JsonRingSignal::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  condition.wait_for(lock, std::chrono::milliseconds(RING_PARK_MS), [this] { return signalled; });
+  signalled = false;
+}
+
+void JsonRingSignal::wake() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    signalled = true;
+  }
+  condition.notify_one();
+}
+
+#else
+
+JsonRingSignal::JsonRingSignal() {
+}
+
+JsonRingSignal::~JsonRingSignal() {
+}
+
+void JsonRingSignal::wait() {
+  yield();
+}
+
+void JsonRingSignal::wake() {
+}
+
+#endif
+
+JsonEventRing::JsonEventRing(uint8_t *storage, size_t capacity) {
+  this->storage = storage;
+  mask = capacity - 1;
+  maxPayload = min(capacity - RECORD_HEADER_LENGTH, (size_t) BUFFER_MAX_LENGTH - 1);
+}
+
+void JsonEventRing::reset() {
+  head = 0;
+  tail = 0;
+  ended = false;
+  finished = false;
+}
+
+boolean JsonEventRing::isFinished() {
+  return finished;
+}
+
+void JsonEventRing::close() {
+  if (!ended) {
+    error("Input ended before the end of the document");
+  }
+}
+
+boolean JsonEventRing::waitForRoom(size_t length) {
+  int spins = 0;
+  while (mask + 1 - (head - tail) < length) {
+    // nobody is going to make room any more
+    if (finished) {
+      return false;
+    }
+    spins++;
+    if (spins < RING_SPIN_COUNT) {
+      continue;
+    }
+    if (spins < RING_SPIN_COUNT + RING_YIELD_COUNT) {
+      yield();
+      continue;
+    }
+    spins = 0;
+    // sleep until a good part of the ring is free, not just this record
+    roomWanted = length > (mask + 1) / 2 ? length : (mask + 1) / 2;
+    roomSignal.waiting = true;
+    __sync_synchronize();
+    if (mask + 1 - (head - tail) < length && !finished) {
+      roomSignal.wait();
+    }
+    roomSignal.waiting = false;
+  }
+  // make sure the consumer is done reading the bytes we will overwrite
+  __sync_synchronize();
+  return true;
+}
+
+void JsonEventRing::put(size_t *pos, uint8_t b) {
+  storage[*pos & mask] = b;
+  (*pos)++;
+}
+
+uint8_t JsonEventRing::get(size_t *pos) {
+  uint8_t b = storage[*pos & mask];
+  (*pos)++;
+  return b;
+}
+
+void JsonEventRing::putRecord(uint8_t event, int flag, const char *data, size_t length) {
+  if (length > maxPayload) {
+    length = maxPayload;
+  }
+  // once the consumer has stopped the rest of the document is dropped
+  if (finished || !waitForRoom(RECORD_HEADER_LENGTH + length)) {
+    return;
+  }
+  size_t pos = head;
+  put(&pos, event);
+  put(&pos, (uint8_t) flag);
+  put(&pos, (uint8_t) (length >> 8));
+  put(&pos, (uint8_t) length);
+  for (size_t i = 0; i < length; i++) {
+    put(&pos, data[i]);
+  }
+  // publish the record only after all of its bytes are written; the
+  // exchange is also a full barrier, so that we either see the consumer
+  // parking or it sees the record
+  __atomic_exchange_n(&head, pos, __ATOMIC_SEQ_CST);
+  dataSignal.notify();
+}
+
+void JsonEventRing::putPieces(uint8_t event, const char *data, size_t length, boolean final) {
+  while (length > maxPayload) {
+    putRecord(event, false, data, maxPayload);
+    data += maxPayload;
+    length -= maxPayload;
+  }
+  putRecord(event, final, data, length);
+}
+
+int JsonEventRing::replay(JsonListener *listener) {
+  int events = 0;
+  size_t pos = tail;
+  size_t end = head;
+  __sync_synchronize();
+  while (pos != end && !finished) {
+    uint8_t event = get(&pos);
+    uint8_t flag = get(&pos);
+    size_t length = get(&pos) << 8;
+    length |= get(&pos);
+    for (size_t i = 0; i < length; i++) {
+      scratch[i] = get(&pos);
+    }
+    scratch[length] = '\0';
+    // hand the space back before calling the listener, which may be slow;
+    // a full barrier like in putRecord()
+    __atomic_exchange_n(&tail, pos, __ATOMIC_SEQ_CST);
+    if (roomSignal.waiting && mask + 1 - (head - pos) >= roomWanted) {
+      roomSignal.notify();
+    }
+
+    switch (event) {
+      case EVENT_WHITESPACE:
+        listener->whitespace(scratch[0]);
+        break;
+      case EVENT_START_DOCUMENT:
+        listener->startDocument();
+        break;
+      case EVENT_KEY:
+        listener->key(scratch);
+        break;
+      case EVENT_VALUE:
+        listener->typedValue(scratch, flag);
+        break;
+      case EVENT_END_ARRAY:
+        listener->endArray();
+        break;
+      case EVENT_END_OBJECT:
+        listener->endObject();
+        break;
+      case EVENT_END_DOCUMENT:
+        listener->endDocument();
+        finished = true;
+        break;
+      case EVENT_START_ARRAY:
+        listener->startArray();
+        break;
+      case EVENT_START_OBJECT:
+        listener->startObject();
+        break;
+      case EVENT_ERROR:
+        listener->error(scratch);
+        finished = true;
+        break;
+      case EVENT_KEY_CHUNK:
+        listener->keyChunk(scratch, length, flag);
+        break;
+      case EVENT_VALUE_CHUNK:
+        listener->valueChunk(scratch, length, flag);
+        break;
+      case EVENT_RAW_VALUE:
+        listener->rawValue(scratch, length, flag);
+        break;
+    }
+    events++;
+  }
+  if (finished) {
+    // a producer waiting for room can give up now
+    __sync_synchronize();
+    roomSignal.notify();
+  }
+  return events;
+}
+
+void JsonEventRing::replayAll(JsonListener *listener) {
+  int spins = 0;
+  while (!finished) {
+    if (replay(listener) > 0) {
+      spins = 0;
+      continue;
+    }
+    spins++;
+    if (spins < RING_SPIN_COUNT) {
+      continue;
+    }
+    if (spins < RING_SPIN_COUNT + RING_YIELD_COUNT) {
+      yield();
+      continue;
+    }
+    spins = 0;
+    dataSignal.waiting = true;
+    __sync_synchronize();
+    if (head == tail) {
+      dataSignal.wait();
+    }
+    dataSignal.waiting = false;
+  }
+}
+
+void JsonEventRing::whitespace(char c) {
+  putRecord(EVENT_WHITESPACE, 0, &c, 1);
+}
+
+void JsonEventRing::startDocument() {
+  putRecord(EVENT_START_DOCUMENT, 0, NULL, 0);
+}
+
+void JsonEventRing::key(const char *key) {
+  putRecord(EVENT_KEY, 0, key, strlen(key));
+}
+
+void JsonEventRing::value(const char *value) {
+  putRecord(EVENT_VALUE, VALUE_TYPE_STRING, value, strlen(value));
+}
+
+void JsonEventRing::typedValue(const char *value, int type) {
+  putRecord(EVENT_VALUE, type, value, strlen(value));
+}
+
+void JsonEventRing::keyChunk(const char *data, size_t length, boolean final) {
+  putPieces(EVENT_KEY_CHUNK, data, length, final);
+}
+
+void JsonEventRing::valueChunk(const char *data, size_t length, boolean final) {
+  putPieces(EVENT_VALUE_CHUNK, data, length, final);
+}
+
+void JsonEventRing::rawValue(const char *data, size_t length, boolean final) {
+  putPieces(EVENT_RAW_VALUE, data, length, final);
+}
+
+void JsonEventRing::endArray() {
+  putRecord(EVENT_END_ARRAY, 0, NULL, 0);
+}
+
+void JsonEventRing::endObject() {
+  putRecord(EVENT_END_OBJECT, 0, NULL, 0);
+}
+
+void JsonEventRing::endDocument() {
+  ended = true;
+  putRecord(EVENT_END_DOCUMENT, 0, NULL, 0);
+}
+
+void JsonEventRing::startArray() {
+  putRecord(EVENT_START_ARRAY, 0, NULL, 0);
+}
+
+void JsonEventRing::startObject() {
+  putRecord(EVENT_START_OBJECT, 0, NULL, 0);
+}
+
+void JsonEventRing::error( const char *message ) {
+  ended = true;
+  putRecord(EVENT_ERROR, 0, message, strlen(message));
+}
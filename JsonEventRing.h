@@ -0,0 +1,214 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "MockArduino.h"
+#endif
+#include "JsonListener.h"
+#include "JsonStreamingParser.h"
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#elif !defined(ARDUINO)
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+#define EVENT_WHITESPACE         0
+#define EVENT_START_DOCUMENT     1
+#define EVENT_KEY                2
+#define EVENT_VALUE              3
+#define EVENT_END_ARRAY          4
+#define EVENT_END_OBJECT         5
+#define EVENT_END_DOCUMENT       6
+#define EVENT_START_ARRAY        7
+#define EVENT_START_OBJECT       8
+#define EVENT_ERROR              9
+#define EVENT_KEY_CHUNK          10
+#define EVENT_VALUE_CHUNK        11
+#define EVENT_RAW_VALUE          12
+
+// times a full or empty ring is polled before the waiting side yields,
+// and how often it yields before it parks
+#define RING_SPIN_COUNT          1000
+#define RING_YIELD_COUNT         16
+// longest a parked side sleeps before it looks at the ring again, in ms;
+// a safety net, the other side normally wakes it much earlier
+#define RING_PARK_MS             10
+
+/**
+ * Lets one side of a JsonEventRing sleep until the other side has made
+ * progress: a FreeRTOS semaphore on the ESP32 and a condition variable on
+ * a desktop. Other boards have nothing to sleep on, there wait() only
+ * calls yield().
+ */
+class JsonRingSignal {
+  private:
+#if defined(ESP32)
+    SemaphoreHandle_t semaphore;
+#elif !defined(ARDUINO)
+    std::mutex mutex;
+    std::condition_variable condition;
+    boolean signalled = false;
+#endif
+
+    JsonRingSignal(const JsonRingSignal&);
+    JsonRingSignal& operator=(const JsonRingSignal&);
+
+    void wake();
+
+  public:
+    // Set by the sleeping side before it looks at the ring one last time,
+    // so that the other side either sees the flag or the sleeper sees the
+    // other side's progress
+    volatile boolean waiting = false;
+
+    JsonRingSignal();
+    ~JsonRingSignal();
+
+    // Sleeps until notify() or for at most RING_PARK_MS; returns at once if
+    // notify() was called since waiting was set
+    void wait();
+
+    // Wakes the other side if it is waiting; cheap if it is not
+    void notify() {
+      if (waiting) {
+        waiting = false;
+        wake();
+      }
+    }
+};
+
+/**
+ * Listener that records the parser events in a lock-free ring buffer, so
+ * that another task or core can replay them into the real listener while
+ * the parser keeps going. There must be exactly one producer (the parser)
+ * and one consumer (replay()) and they must not run on the same task,
+ * since the producer waits for room when the ring is full and the
+ * consumer waits for events when it is empty. Either side first spins for
+ * a while, then yields a few times and then parks on a JsonRingSignal until
+ * the other side wakes it; a parked producer is only woken once half of
+ * the ring is free again. Once the consumer has replayed endDocument() or
+ * error() it stops, and the producer drops everything it records after
+ * that instead of waiting.
+ *
+ * Every event is one record: a type byte followed by the value type or
+ * final flag and the string bytes where the event has them. Strings are
+ * copied into the ring; chunks and raw values longer than a record are
+ * split up.
+ */
+class JsonEventRing: public JsonListener {
+  private:
+    uint8_t *storage;
+    size_t mask;
+    // free running positions, only written by producer and consumer
+    // respectively
+    volatile size_t head = 0;
+    volatile size_t tail = 0;
+    size_t maxPayload;
+
+    // producer side: endDocument() or error() has been recorded
+    boolean ended = false;
+    // free bytes the parked producer waits for
+    volatile size_t roomWanted = 0;
+
+    // consumer side
+    char scratch[BUFFER_MAX_LENGTH];
+    volatile boolean finished = false;
+
+    // the producer parks on room, the consumer on data
+    JsonRingSignal roomSignal;
+    JsonRingSignal dataSignal;
+
+    // false if the consumer has stopped and the record can be dropped
+    boolean waitForRoom(size_t length);
+
+    void put(size_t *pos, uint8_t b);
+
+    void putRecord(uint8_t event, int flag, const char *data, size_t length);
+
+    void putPieces(uint8_t event, const char *data, size_t length, boolean final);
+
+    uint8_t get(size_t *pos);
+
+  public:
+    // capacity must be a power of two; at least BUFFER_MAX_LENGTH + 8
+    // bytes lets keys and values of any length fit into one record
+    JsonEventRing(uint8_t *storage, size_t capacity);
+
+    // Replays the complete records currently in the ring, returns how
+    // many events were replayed. Never waits, and stops right after
+    // endDocument() or error().
+    int replay(JsonListener *listener);
+
+    // Replays events until the end of the document or an error, waiting
+    // for the producer when the ring is empty
+    void replayAll(JsonListener *listener);
+
+    // True once endDocument() or error() has been replayed
+    boolean isFinished();
+
+    // Called by the producer when there is no more input. If the document
+    // was not complete the consumer gets an error, so that replayAll()
+    // returns on truncated input too.
+    void close();
+
+    // Empties the ring; neither side may be running
+    void reset();
+
+    virtual void whitespace(char c);
+
+    virtual void startDocument();
+
+    virtual void key(const char *key);
+
+    virtual void value(const char *value);
+
+    virtual void typedValue(const char *value, int type);
+
+    virtual void keyChunk(const char *data, size_t length, boolean final);
+
+    virtual void valueChunk(const char *data, size_t length, boolean final);
+
+    virtual void rawValue(const char *data, size_t length, boolean final);
+
+    virtual void endArray();
+
+    virtual void endObject();
+
+    virtual void endDocument();
+
+    virtual void startArray();
+
+    virtual void startObject();
+
+    virtual void error( const char *message );
+};
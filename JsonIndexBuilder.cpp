@@ -0,0 +1,222 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#include "JsonIndexBuilder.h"
+
+JsonIndexBuilder::JsonIndexBuilder(JsonStreamingParserBase *parser, Print *output, long every,
+                                   unsigned long keyDepths, JsonListener *listener) {
+  this->parser = parser;
+  this->output = output;
+  this->every = every;
+  this->keyDepths = keyDepths;
+  this->listener = listener;
+  memset(ordinals, 0, sizeof(ordinals));
+  parser->setListener(this);
+}
+
+unsigned long JsonIndexBuilder::getEntryCount() {
+  return entryCount;
+}
+
+boolean JsonIndexBuilder::parse(const char *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    char c = data[i];
+    if (!parser->parse(c)) {
+      return false;
+    }
+    // inside strings the parser is not at a boundary
+    if ((c == ',' || c == '[' || c == '{') && parser->isAtValueBoundary()) {
+      boundary(c);
+    }
+  }
+  return true;
+}
+
+void JsonIndexBuilder::boundary(char c) {
+  int depth = parser->getDepth();
+  if (c == ',') {
+    ordinals[depth - 1]++;
+  } else {
+    ordinals[depth - 1] = 0;
+  }
+  pending = false;
+  long ordinal = ordinals[depth - 1];
+  boolean inObject = parser->getContainer(depth - 1) == STACK_OBJECT;
+  boolean wanted = (depth == 1 && every > 0 && ordinal % every == 0)
+      || (inObject && depth < (int) sizeof(keyDepths) * 8 && ((keyDepths >> depth) & 1));
+  if (!wanted) {
+    return;
+  }
+  pending = true;
+  pendingPosition = parser->getPosition();
+  pendingOrdinal = ordinal;
+  pendingDepth = depth;
+  memset(pendingContainers, 0, sizeof(pendingContainers));
+  for (int i = 0; i < depth; i++) {
+    if (parser->getContainer(i) == STACK_ARRAY) {
+      pendingContainers[i / 8] |= 1 << (i % 8);
+    }
+  }
+}
+
+void JsonIndexBuilder::writeNumber(unsigned long value) {
+  while (value >= 0x80) {
+    output->write((uint8_t) (value | 0x80));
+    value >>= 7;
+  }
+  output->write((uint8_t) value);
+}
+
+// Writes the entry up to its key
+void JsonIndexBuilder::writeEntry() {
+  pending = false;
+  writeNumber(pendingPosition);
+  writeNumber(pendingOrdinal);
+  output->write(pendingDepth);
+  output->write(pendingContainers, (pendingDepth + 7) / 8);
+  entryCount++;
+}
+
+// A value starts: a pending entry is an array element without a key
+void JsonIndexBuilder::startElement() {
+  if (pending) {
+    writeEntry();
+    output->write((uint8_t) '\0');
+  }
+}
+
+void JsonIndexBuilder::whitespace(char c) {
+  if (listener != NULL) {
+    listener->whitespace(c);
+  }
+}
+
+void JsonIndexBuilder::startDocument() {
+  output->write((const uint8_t *) INDEX_MAGIC, 4);
+  output->write((uint8_t) INDEX_VERSION);
+  entryCount = 0;
+  pending = false;
+  keyOpen = false;
+  if (listener != NULL) {
+    listener->startDocument();
+  }
+}
+
+void JsonIndexBuilder::key(const char *key) {
+  if (pending) {
+    writeEntry();
+    output->write((const uint8_t *) key, strlen(key) + 1);
+  }
+  if (listener != NULL) {
+    listener->key(key);
+  }
+}
+
+void JsonIndexBuilder::value(const char *value) {
+  startElement();
+  if (listener != NULL) {
+    listener->value(value);
+  }
+}
+
+void JsonIndexBuilder::typedValue(const char *value, int type) {
+  startElement();
+  if (listener != NULL) {
+    listener->typedValue(value, type);
+  }
+}
+
+void JsonIndexBuilder::keyChunk(const char *data, size_t length, boolean final) {
+  if (pending) {
+    writeEntry();
+    keyOpen = true;
+  }
+  if (keyOpen) {
+    output->write((const uint8_t *) data, length);
+    if (final) {
+      output->write((uint8_t) '\0');
+      keyOpen = false;
+    }
+  }
+  if (listener != NULL) {
+    listener->keyChunk(data, length, final);
+  }
+}
+
+void JsonIndexBuilder::valueChunk(const char *data, size_t length, boolean final) {
+  startElement();
+  if (listener != NULL) {
+    listener->valueChunk(data, length, final);
+  }
+}
+
+void JsonIndexBuilder::rawValue(const char *data, size_t length, boolean final) {
+  startElement();
+  if (listener != NULL) {
+    listener->rawValue(data, length, final);
+  }
+}
+
+void JsonIndexBuilder::endArray() {
+  // an empty array has no element to index
+  pending = false;
+  if (listener != NULL) {
+    listener->endArray();
+  }
+}
+
+void JsonIndexBuilder::endObject() {
+  pending = false;
+  if (listener != NULL) {
+    listener->endObject();
+  }
+}
+
+void JsonIndexBuilder::endDocument() {
+  if (listener != NULL) {
+    listener->endDocument();
+  }
+}
+
+void JsonIndexBuilder::startArray() {
+  startElement();
+  if (listener != NULL) {
+    listener->startArray();
+  }
+}
+
+void JsonIndexBuilder::startObject() {
+  startElement();
+  if (listener != NULL) {
+    listener->startObject();
+  }
+}
+
+void JsonIndexBuilder::error( const char *message ) {
+  pending = false;
+  if (listener != NULL) {
+    listener->error(message);
+  }
+}
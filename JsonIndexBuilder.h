@@ -0,0 +1,116 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "MockArduino.h"
+#endif
+#include "JsonListener.h"
+#include "JsonStreamingParser.h"
+#include "JsonIndexReader.h"
+
+/**
+ * Builds an index of a document in one pass, so that later runs can
+ * resume a parser right at the interesting elements instead of parsing
+ * everything before them. It records every Nth element of the top-level
+ * container and every key of objects at the chosen depths, and writes the
+ * entries to any Print (e.g. a File next to the document) in the compact
+ * format described in JsonIndexReader.h.
+ *
+ * The builder is the parser's listener and passes all events on to an
+ * optional listener of your own. Feed the document through the builder's
+ * parse(), which hands it to the parser one character at a time.
+ */
+class JsonIndexBuilder: public JsonListener {
+  private:
+    JsonStreamingParserBase *parser;
+    Print *output;
+    JsonListener *listener;
+    long every;
+    unsigned long keyDepths;
+    unsigned long entryCount = 0;
+
+    // element numbers within every open container
+    long ordinals[STACK_MAX_LENGTH];
+
+    // entry waiting for the first event of its element, which tells
+    // whether there is an element at all and what its key is
+    boolean pending = false;
+    boolean keyOpen = false;
+    long pendingPosition;
+    long pendingOrdinal;
+    uint8_t pendingDepth;
+    uint8_t pendingContainers[(STACK_MAX_LENGTH + 7) / 8];
+
+    void boundary(char c);
+
+    void writeNumber(unsigned long value);
+
+    void writeEntry();
+
+    void startElement();
+
+  public:
+    // every: index every Nth element of the top-level array or object, 0
+    // for none. keyDepths: bit n set indexes every key of objects at depth n,
+    // where the top-level object is depth 1.
+    JsonIndexBuilder(JsonStreamingParserBase *parser, Print *output, long every, unsigned long keyDepths,
+                     JsonListener *listener = NULL);
+
+    boolean parse(const char *data, size_t length);
+
+    unsigned long getEntryCount();
+
+    virtual void whitespace(char c);
+
+    virtual void startDocument();
+
+    virtual void key(const char *key);
+
+    virtual void value(const char *value);
+
+    virtual void typedValue(const char *value, int type);
+
+    virtual void keyChunk(const char *data, size_t length, boolean final);
+
+    virtual void valueChunk(const char *data, size_t length, boolean final);
+
+    virtual void rawValue(const char *data, size_t length, boolean final);
+
+    virtual void endArray();
+
+    virtual void endObject();
+
+    virtual void endDocument();
+
+    virtual void startArray();
+
+    virtual void startObject();
+
+    virtual void error( const char *message );
+};
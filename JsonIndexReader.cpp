@@ -0,0 +1,91 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#include "JsonIndexReader.h"
+
+#define INDEX_HEADER_LENGTH      5
+
+JsonIndexReader::JsonIndexReader(const uint8_t *data, size_t length) {
+  this->data = data;
+  this->length = length;
+  valid = length >= INDEX_HEADER_LENGTH && memcmp(data, INDEX_MAGIC, 4) == 0 && data[4] == INDEX_VERSION;
+  rewind();
+}
+
+boolean JsonIndexReader::isValid() {
+  return valid;
+}
+
+void JsonIndexReader::rewind() {
+  pos = INDEX_HEADER_LENGTH;
+}
+
+boolean JsonIndexReader::readNumber(long *value) {
+  unsigned long result = 0;
+  for (int shift = 0; pos < length && shift < (int) sizeof(result) * 8; shift += 7) {
+    uint8_t b = data[pos];
+    pos++;
+    result |= (unsigned long) (b & 0x7f) << shift;
+    if ((b & 0x80) == 0) {
+      *value = (long) result;
+      return *value >= 0;
+    }
+  }
+  return false;
+}
+
+boolean JsonIndexReader::next(JsonIndexEntry *entry) {
+  if (!valid || pos >= length) {
+    return false;
+  }
+  if (!readNumber(&entry->position) || !readNumber(&entry->ordinal) || pos >= length) {
+    pos = length;
+    return false;
+  }
+  entry->depth = data[pos];
+  pos++;
+  size_t containerBytes = (entry->depth + 7) / 8;
+  if (entry->depth < 1 || entry->depth >= STACK_MAX_LENGTH || pos + containerBytes > length) {
+    pos = length;
+    return false;
+  }
+  for (int i = 0; i < entry->depth; i++) {
+    boolean isArray = (data[pos + i / 8] >> (i % 8)) & 1;
+    entry->containers[i] = isArray ? STACK_ARRAY : STACK_OBJECT;
+  }
+  pos += containerBytes;
+  const uint8_t *end = (const uint8_t *) memchr(data + pos, '\0', length - pos);
+  if (end == NULL) {
+    pos = length;
+    return false;
+  }
+  entry->key = (const char *) (data + pos);
+  pos = end - data + 1;
+  return true;
+}
+
+boolean JsonIndexReader::resume(JsonStreamingParserBase *parser, const JsonIndexEntry *entry) {
+  return parser->resumeAt(entry->containers, entry->depth, entry->position);
+}
@@ -0,0 +1,89 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "MockArduino.h"
+#endif
+#include "JsonStreamingParser.h"
+
+// An index starts with these four bytes and a version byte. Every entry is
+//   position      unsigned LEB128
+//   ordinal       unsigned LEB128
+//   depth         one byte, 1 .. STACK_MAX_LENGTH - 1
+//   containers    (depth + 7) / 8 bytes, bit n (lowest first) is set if
+//                 level n is an array
+//   key           '\0' terminated, empty if the container is an array
+#define INDEX_MAGIC              "JSIX"
+#define INDEX_VERSION            1
+
+struct JsonIndexEntry {
+  // byte offset in the document just after the '[', '{' or ',' before the
+  // element, where a parser can be resumed
+  long position;
+  // number of the element within its container, counting from 0
+  long ordinal;
+  int depth;
+  // STACK_OBJECT or STACK_ARRAY for every open container
+  int containers[STACK_MAX_LENGTH];
+  // key of the element if it is in an object, "" otherwise; points into
+  // the index data
+  const char *key;
+};
+
+/**
+ * Reads an index written by JsonIndexBuilder from memory, e.g. a sidecar
+ * file mapped with mmap() or read into a buffer. Nothing is copied; the
+ * data must stay around while the entries are used.
+ */
+class JsonIndexReader {
+  private:
+    const uint8_t *data;
+    size_t length;
+    size_t pos;
+    boolean valid;
+
+    boolean readNumber(long *value);
+
+  public:
+    JsonIndexReader(const uint8_t *data, size_t length);
+
+    // False if the data does not start with an index header
+    boolean isValid();
+
+    // Reads the next entry; false at the end of the index or if the rest of
+    // it is damaged
+    boolean next(JsonIndexEntry *entry);
+
+    // Starts over with the first entry
+    void rewind();
+
+    // Resumes the parser at the entry. Feed it the document from
+    // entry->position on; the first event is the element's key or value.
+    static boolean resume(JsonStreamingParserBase *parser, const JsonIndexEntry *entry);
+};
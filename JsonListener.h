@@ -31,6 +31,12 @@ See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-p
 #include "MockArduino.h"
 #endif
 
+#define VALUE_TYPE_STRING        0
+#define VALUE_TYPE_NUMBER        1
+#define VALUE_TYPE_TRUE          2
+#define VALUE_TYPE_FALSE         3
+#define VALUE_TYPE_NULL          4
+
 class JsonListener {
   private:
 
@@ -44,6 +50,29 @@ class JsonListener {
 
     virtual void value(const char *value) = 0;
 
+    // Called by the parser for every value. type is one of the VALUE_TYPE_*
+    // constants, so listeners can tell the string "true" from the literal.
+    // Forwards to value() unless overridden.
+    virtual void typedValue(const char *value, int type) {
+      this->value(value);
+    }
+
+    // Only called if string chunking is enabled on the parser, instead of
+    // key() and value(). The pieces are unescaped UTF-8 and a multi-byte
+    // character may be split between two of them. The last piece of every
+    // string has final set and may be empty.
+    virtual void keyChunk(const char *data, size_t length, boolean final) {
+    }
+
+    virtual void valueChunk(const char *data, size_t length, boolean final) {
+    }
+
+    // Bytes of a value requested with JsonStreamingParser::captureNextValue(),
+    // exactly as they appear in the input. A value may arrive in several
+    // slices; the last one has final set and may be empty.
+    virtual void rawValue(const char *data, size_t length, boolean final) {
+    }
+
     virtual void endArray() = 0;
 
     virtual void endObject() = 0;
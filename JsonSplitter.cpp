@@ -0,0 +1,155 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#include "JsonSplitter.h"
+
+void JsonSplitter::split(const char *data, size_t length, JsonSegment segments[], int count) {
+  size_t segmentLength = length / count;
+  for (int i = 0; i < count; i++) {
+    segments[i].data = data + i * segmentLength;
+    segments[i].length = (i == count - 1) ? length - i * segmentLength : segmentLength;
+    segments[i].boundary = SEGMENT_NO_BOUNDARY;
+  }
+}
+
+uint8_t JsonSplitter::scanFrom(const char *data, size_t length, uint8_t state, long *depthChange) {
+  long depth = 0;
+  for (size_t i = 0; i < length; i++) {
+    char c = data[i];
+    if (state == SPLIT_OUTSIDE_STRING) {
+      if (c == '"') {
+        state = SPLIT_IN_STRING;
+      } else if (c == '[' || c == '{') {
+        depth++;
+      } else if (c == ']' || c == '}') {
+        depth--;
+      }
+    } else if (state == SPLIT_IN_STRING) {
+      if (c == '\\') {
+        state = SPLIT_AFTER_ESCAPE;
+      } else if (c == '"') {
+        state = SPLIT_OUTSIDE_STRING;
+      }
+    } else {
+      state = SPLIT_IN_STRING;
+    }
+  }
+  *depthChange = depth;
+  return state;
+}
+
+void JsonSplitter::scan(JsonSegment *segment) {
+  const char *data = segment->data;
+  size_t length = segment->length;
+  segment->endState[SPLIT_OUTSIDE_STRING] = scanFrom(data, length, SPLIT_OUTSIDE_STRING,
+                                                     &segment->depthChange[SPLIT_OUTSIDE_STRING]);
+  segment->endState[SPLIT_IN_STRING] = scanFrom(data, length, SPLIT_IN_STRING,
+                                                &segment->depthChange[SPLIT_IN_STRING]);
+  if (length > 0 && (data[0] == '\\' || data[0] == '"')) {
+    segment->endState[SPLIT_AFTER_ESCAPE] = scanFrom(data, length, SPLIT_AFTER_ESCAPE,
+                                                     &segment->depthChange[SPLIT_AFTER_ESCAPE]);
+  } else {
+    // any other first character leaves us inside the string either way
+    segment->endState[SPLIT_AFTER_ESCAPE] = segment->endState[SPLIT_IN_STRING];
+    segment->depthChange[SPLIT_AFTER_ESCAPE] = segment->depthChange[SPLIT_IN_STRING];
+  }
+}
+
+void JsonSplitter::resolve(JsonSegment segments[], int count) {
+  uint8_t state = SPLIT_OUTSIDE_STRING;
+  long depth = 0;
+  for (int i = 0; i < count; i++) {
+    segments[i].startState = state;
+    segments[i].startDepth = depth;
+    depth += segments[i].depthChange[state];
+    state = segments[i].endState[state];
+  }
+}
+
+void JsonSplitter::findBoundary(JsonSegment *segment, int targetDepth) {
+  uint8_t state = segment->startState;
+  long depth = segment->startDepth;
+  for (size_t i = 0; i < segment->length; i++) {
+    char c = segment->data[i];
+    if (state == SPLIT_OUTSIDE_STRING) {
+      if (c == '"') {
+        state = SPLIT_IN_STRING;
+      } else if (c == '[' || c == '{') {
+        depth++;
+      } else if (c == ']' || c == '}') {
+        depth--;
+      } else if (c == ',' && depth == targetDepth) {
+        segment->boundary = i + 1;
+        return;
+      }
+    } else if (state == SPLIT_IN_STRING) {
+      if (c == '\\') {
+        state = SPLIT_AFTER_ESCAPE;
+      } else if (c == '"') {
+        state = SPLIT_OUTSIDE_STRING;
+      }
+    } else {
+      state = SPLIT_IN_STRING;
+    }
+  }
+  segment->boundary = SEGMENT_NO_BOUNDARY;
+}
+
+boolean JsonSplitter::parseSegment(JsonStreamingParserBase *parser, JsonSegment segments[], int index, int count,
+                                   const int containers[], int targetDepth) {
+  const char *start;
+  if (index == 0) {
+    start = segments[0].data;
+    parser->reset();
+  } else if (segments[index].boundary == SEGMENT_NO_BOUNDARY) {
+    // the elements overlapping this segment belong to an earlier one
+    return true;
+  } else {
+    start = segments[index].data + segments[index].boundary;
+    if (!parser->resumeAt(containers, targetDepth, start - segments[0].data)) {
+      return false;
+    }
+  }
+
+  const char *end = segments[count - 1].data + segments[count - 1].length;
+  boolean isLast = true;
+  for (int i = index + 1; i < count; i++) {
+    if (segments[i].boundary != SEGMENT_NO_BOUNDARY) {
+      end = segments[i].data + segments[i].boundary;
+      isLast = false;
+      break;
+    }
+  }
+
+  for (const char *c = start; c < end; c++) {
+    if (!parser->parse(*c)) {
+      return false;
+    }
+  }
+  if (isLast) {
+    return parser->getDepth() == 0;
+  }
+  return parser->isAtValueBoundary() && parser->getDepth() == targetDepth;
+}
@@ -0,0 +1,95 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "MockArduino.h"
+#endif
+#include "JsonStreamingParser.h"
+
+#define SPLIT_OUTSIDE_STRING     0
+#define SPLIT_IN_STRING          1
+#define SPLIT_AFTER_ESCAPE       2
+
+#define SEGMENT_NO_BOUNDARY      ((size_t) -1)
+
+struct JsonSegment {
+  const char *data;
+  size_t length;
+
+  // set by scan(): state at the end of the segment and the change in
+  // nesting depth, for each of the three SPLIT_* states it may start in
+  uint8_t endState[3];
+  long depthChange[3];
+
+  // set by resolve()
+  uint8_t startState;
+  long startDepth;
+
+  // set by findBoundary(): offset just after the first ',' separating two
+  // elements at the target depth, or SEGMENT_NO_BOUNDARY
+  size_t boundary;
+};
+
+/**
+ * Splits one large in-memory document (e.g. a huge top-level array) into
+ * segments that can be parsed by several parsers at once, e.g. one per core
+ * on an ESP32:
+ *
+ * 1. split() the buffer into segments, then scan() every segment. Each scan
+ *    only looks at its own segment and may run in parallel.
+ * 2. resolve() the segments, which is cheap and sequential: the quote
+ *    parity and depth of each segment follow from the ones before it.
+ * 3. findBoundary() in every segment, in parallel.
+ * 4. parseSegment() every segment with its own parser and listener. The
+ *    first one starts the document, the others are resumed at their
+ *    boundary with the given containers, and every parser must end exactly
+ *    at the next boundary, otherwise the seam is reported as invalid.
+ *
+ * Events are delivered per parser; elements are in document order within
+ * a segment and segments follow each other in index order.
+ */
+class JsonSplitter {
+  private:
+    static uint8_t scanFrom(const char *data, size_t length, uint8_t state, long *depthChange);
+
+  public:
+    static void split(const char *data, size_t length, JsonSegment segments[], int count);
+
+    static void scan(JsonSegment *segment);
+
+    static void resolve(JsonSegment segments[], int count);
+
+    static void findBoundary(JsonSegment *segment, int targetDepth);
+
+    // containers describes the enclosing containers of the elements down to
+    // targetDepth, e.g. { STACK_ARRAY } for a top-level array. Returns false
+    // on a parse error or if the segment does not end at the next boundary.
+    static boolean parseSegment(JsonStreamingParserBase *parser, JsonSegment segments[], int index, int count,
+                                const int containers[], int targetDepth);
+};
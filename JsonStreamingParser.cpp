@@ -24,95 +24,229 @@ See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-p
 */
 
 #include "JsonStreamingParser.h"
+#include <stdarg.h>
 
 #ifdef USE_LONG_ERRORS
-const char PROGMEM_ERR0[] PROGMEM = "Unescaped control character encountered: %c at position: %d";
-const char PROGMEM_ERR1[] PROGMEM = "Start of string expected for object key. Instead got: %c at position: %d";
-const char PROGMEM_ERR2[] PROGMEM = "Expected ':' after key. Instead got %c at position %d";
-const char PROGMEM_ERR3[] PROGMEM = "Expected ',' or '}' while parsing object. Got: %c at position %d";
-const char PROGMEM_ERR4[] PROGMEM = "Expected ',' or ']' while parsing array. Got: %c at position: %d";
-const char PROGMEM_ERR5[] PROGMEM = "Finished a literal, but unclear what state to move to. Last state: %d";
-const char PROGMEM_ERR6[] PROGMEM = "Cannot have multiple decimal points in a number at: %d";
-const char PROGMEM_ERR7[] PROGMEM = "Cannot have a decimal point in an exponent at: %d";
-const char PROGMEM_ERR8[] PROGMEM = "Cannot have multiple exponents in a number at: %d";
-const char PROGMEM_ERR9[] PROGMEM = "Can only have '+' or '-' after the 'e' or 'E' in a number at: %d";
+const char PROGMEM_ERR0[] PROGMEM = "Unescaped control character encountered: %c at position: %ld";
+const char PROGMEM_ERR1[] PROGMEM = "Start of string expected for object key. Instead got: %c at position: %ld";
+const char PROGMEM_ERR2[] PROGMEM = "Expected ':' after key. Instead got %c at position %ld";
+const char PROGMEM_ERR3[] PROGMEM = "Expected ',' or '}' while parsing object. Got: %c at position %ld";
+const char PROGMEM_ERR4[] PROGMEM = "Expected ',' or ']' while parsing array. Got: %c at position: %ld";
+const char PROGMEM_ERR5[] PROGMEM = "Finished a literal, but unclear what state to move to. Last state: %ld";
+const char PROGMEM_ERR6[] PROGMEM = "Cannot have multiple decimal points in a number at: %ld";
+const char PROGMEM_ERR7[] PROGMEM = "Cannot have a decimal point in an exponent at: %ld";
+const char PROGMEM_ERR8[] PROGMEM = "Cannot have multiple exponents in a number at: %ld";
+const char PROGMEM_ERR9[] PROGMEM = "Can only have '+' or '-' after the 'e' or 'E' in a number at: %ld";
 const char PROGMEM_ERR10[] PROGMEM = "Document must start with object or array";
 const char PROGMEM_ERR11[] PROGMEM = "Expected end of document";
-const char PROGMEM_ERR12[] PROGMEM = "Internal error. Reached an unknown state at: %d";
+const char PROGMEM_ERR12[] PROGMEM = "Internal error. Reached an unknown state at: %ld";
 const char PROGMEM_ERR13[] PROGMEM = "Unexpected end of string";
 const char PROGMEM_ERR14[] PROGMEM = "Unexpected character for value";
 const char PROGMEM_ERR15[] PROGMEM = "Unexpected end of array encountered";
 const char PROGMEM_ERR16[] PROGMEM = "Unexpected end of object encountered";
 const char PROGMEM_ERR17[] PROGMEM = "Expected escaped character after backslash";
 const char PROGMEM_ERR18[] PROGMEM = "Expected hex character for escaped Unicode character";
-const char PROGMEM_ERR19[] PROGMEM = "Expected '\\u' following a Unicode high surrogate";
 const char PROGMEM_ERR20[] PROGMEM = "Expected 'true'";
 const char PROGMEM_ERR21[] PROGMEM = "Expected 'false'";
 const char PROGMEM_ERR22[] PROGMEM = "Expected 'null'";
+const char PROGMEM_ERR23[] PROGMEM = "Invalid UTF-8 sequence in string at position: %ld";
+const char PROGMEM_ERR24[] PROGMEM = "No token buffer available at position: %ld";
+const char PROGMEM_ERR25[] PROGMEM = "Document nested too deeply at position: %ld";
 #else
-const char PROGMEM_ERR0[] PROGMEM = "err0: %c at: %d";
-const char PROGMEM_ERR1[] PROGMEM = "err1: %c at: %d";
-const char PROGMEM_ERR2[] PROGMEM = "err2: %c at: %d";
-const char PROGMEM_ERR3[] PROGMEM = "err3: %c at: %d";
-const char PROGMEM_ERR4[] PROGMEM = "err4: %c at: %d";
-const char PROGMEM_ERR5[] PROGMEM = "err5: %d";
-const char PROGMEM_ERR6[] PROGMEM = "err6: at: %d";
-const char PROGMEM_ERR7[] PROGMEM = "err7: at: %d";
-const char PROGMEM_ERR8[] PROGMEM = "err8: at: %d";
-const char PROGMEM_ERR9[] PROGMEM = "err9: at: %d";
+const char PROGMEM_ERR0[] PROGMEM = "err0: %c at: %ld";
+const char PROGMEM_ERR1[] PROGMEM = "err1: %c at: %ld";
+const char PROGMEM_ERR2[] PROGMEM = "err2: %c at: %ld";
+const char PROGMEM_ERR3[] PROGMEM = "err3: %c at: %ld";
+const char PROGMEM_ERR4[] PROGMEM = "err4: %c at: %ld";
+const char PROGMEM_ERR5[] PROGMEM = "err5: %ld";
+const char PROGMEM_ERR6[] PROGMEM = "err6: at: %ld";
+const char PROGMEM_ERR7[] PROGMEM = "err7: at: %ld";
+const char PROGMEM_ERR8[] PROGMEM = "err8: at: %ld";
+const char PROGMEM_ERR9[] PROGMEM = "err9: at: %ld";
 const char PROGMEM_ERR10[] PROGMEM = "err10";
 const char PROGMEM_ERR11[] PROGMEM = "err11";
-const char PROGMEM_ERR12[] PROGMEM = "err12: %d";
+const char PROGMEM_ERR12[] PROGMEM = "err12: %ld";
 const char PROGMEM_ERR13[] PROGMEM = "err13";
 const char PROGMEM_ERR14[] PROGMEM = "err14";
 const char PROGMEM_ERR15[] PROGMEM = "err15";
 const char PROGMEM_ERR16[] PROGMEM = "err16";
 const char PROGMEM_ERR17[] PROGMEM = "err17";
 const char PROGMEM_ERR18[] PROGMEM = "err18";
-const char PROGMEM_ERR19[] PROGMEM = "err19";
 const char PROGMEM_ERR20[] PROGMEM = "err20";
 const char PROGMEM_ERR21[] PROGMEM = "err21";
 const char PROGMEM_ERR22[] PROGMEM = "err22";
+const char PROGMEM_ERR23[] PROGMEM = "err23: at: %ld";
+const char PROGMEM_ERR24[] PROGMEM = "err24: at: %ld";
+const char PROGMEM_ERR25[] PROGMEM = "err25: at: %ld";
 #endif
 
-JsonStreamingParser::JsonStreamingParser() {
+JsonStreamingParserBase::JsonStreamingParserBase(char* buffer, uint16_t bufferLength, JsonBufferPool* pool) {
+    this->buffer = buffer;
+    this->bufferLength = bufferLength;
+    this->pool = pool;
+    doChunkStrings = false;
+    doValidateUtf8 = false;
+    captureInString = false;
+    captureEscape = false;
     reset();
 }
 
-void JsonStreamingParser::reset() {
+JsonStreamingParserBase::~JsonStreamingParserBase() {
+    releaseBuffer();
+}
+
+JsonStreamingParser::JsonStreamingParser(): JsonStreamingParserBase(ownBuffer, BUFFER_MAX_LENGTH, NULL) {
+}
+
+JsonPooledParser::JsonPooledParser(JsonBufferPool* pool): JsonStreamingParserBase(NULL, pool->getBlockLength(), pool) {
+}
+
+void JsonStreamingParserBase::reset() {
     state = STATE_START_DOCUMENT;
+    releaseBuffer();
     bufferPos = 0;
     unicodeEscapeBufferPos = 0;
     unicodeBufferPos = 0;
+    unicodeValue = 0;
     characterCounter = 0;
+    stackPos = 0;
+    unicodeHighSurrogate = 0;
+    utf8Remaining = 0;
+    utf8Lower = 0x80;
+    utf8Upper = 0xBF;
+    captureRequested = false;
 }
     
-void JsonStreamingParser::setListener(JsonListener* listener) {
+void JsonStreamingParserBase::setListener(JsonListener* listener) {
   myListener = listener;
 }
 
-bool JsonStreamingParser::parse(char c) {
+void JsonStreamingParserBase::setValidateUtf8(boolean validate) {
+  doValidateUtf8 = validate;
+}
+
+void JsonStreamingParserBase::setStringChunking(boolean chunk) {
+  doChunkStrings = chunk;
+}
+
+void JsonStreamingParserBase::captureNextValue() {
+  captureRequested = true;
+}
+
+bool JsonStreamingParserBase::parse(const char *data, size_t length) {
+  size_t i = 0;
+  boolean result = true;
+  while (i < length) {
+    if (state == STATE_CAPTURE || (captureRequested && isCaptureStart(data[i]))) {
+      size_t consumed = captureRaw(data + i, length - i);
+      characterCounter += consumed;
+      i += consumed;
+      continue;
+    }
+    if (!parseChar(data[i])) {
+      result = false;
+      break;
+    }
+    i++;
+  }
+  // hand out what we have of a string that continues in the next chunk
+  if (result && doChunkStrings && bufferPos > 0 && isInString()) {
+    flushStringChunk(false);
+  }
+  return spillScratch() && result;
+}
+
+bool JsonStreamingParserBase::parse(char c) {
+  boolean result = parseChar(c);
+  return spillScratch() && result;
+}
+
+long JsonStreamingParserBase::getPosition() {
+    return characterCounter;
+}
+
+int JsonStreamingParserBase::getDepth() {
+    // keys and strings in flight sit on the stack too, but are not containers
+    if (stackPos > 0 && (stack[stackPos - 1] == STACK_KEY || stack[stackPos - 1] == STACK_STRING)) {
+      return stackPos - 1;
+    }
+    return stackPos;
+}
+
+int JsonStreamingParserBase::getContainer(int level) {
+    if (level < 0 || level >= getDepth()) {
+      return -1;
+    }
+    return stack[level];
+}
+
+boolean JsonStreamingParserBase::isAtValueBoundary() {
+    return state == STATE_IN_ARRAY || state == STATE_IN_OBJECT;
+}
+
+boolean JsonStreamingParserBase::resumeAt(const int containers[], int depth, long position) {
+    reset();
+    // the stack needs room for at least a key on top of the containers
+    if (depth < 1 || depth >= STACK_MAX_LENGTH) {
+      return false;
+    }
+    for (int i = 0; i < depth; i++) {
+      if (containers[i] != STACK_OBJECT && containers[i] != STACK_ARRAY) {
+        return false;
+      }
+      stack[i] = containers[i];
+    }
+    stackPos = depth;
+    state = containers[depth - 1] == STACK_ARRAY ? STATE_IN_ARRAY : STATE_IN_OBJECT;
+    characterCounter = position;
+    return true;
+}
+
+boolean JsonStreamingParserBase::parseChar(char c) {
     //System.out.print(c);
     // valid whitespace characters in JSON (from RFC4627 for JSON) include:
     // space, horizontal tab, line feed or new line, and carriage return.
     // thanks:
     // http://stackoverflow.com/questions/16042274/definition-of-whitespace-in-json
 
+    if (state == STATE_ERROR) {
+      return false;
+    }
+
+    if (state == STATE_CAPTURE || (captureRequested && isCaptureStart(c))) {
+      if (captureRaw(&c, 1) == 1) {
+        characterCounter++;
+        return true;
+      }
+      // c ended a captured number or literal and is parsed as usual
+    }
+
+    if (captureRequested && state != STATE_END_KEY
+        && !(c == ' ' || c == '\t' || c == '\n' || c == '\r')) {
+      // no value starts right here (e.g. an empty array), so the request
+      // does not carry over to some later value
+      captureRequested = false;
+    }
+
     if ((c == ' ' || c == '\t' || c == '\n' || c == '\r')
         && !(state == STATE_IN_STRING || state == STATE_UNICODE || state == STATE_START_ESCAPE
-            || state == STATE_IN_NUMBER || state == STATE_START_DOCUMENT)) {
+            || state == STATE_UNICODE_SURROGATE || state == STATE_IN_NUMBER || state == STATE_START_DOCUMENT)) {
+      characterCounter++;
       return true;
     }
 
     switch (state) {
     case STATE_IN_STRING:
+      if (doValidateUtf8 && (utf8Remaining > 0 || (uint8_t) c >= 0x80) && !validateUtf8Byte(c)) {
+        reportError( PROGMEM_ERR23, characterCounter );
+        return false;
+      }
       if (c == '"') {
         endString();
       } else if (c == '\\') {
         state = STATE_START_ESCAPE;
-      } else if ((c < 0x1f) || (c == 0x7f)) {
-        sprintf_P( errorMessage, PROGMEM_ERR0, c, characterCounter );
-        myListener->error( errorMessage );
+      } else if (((uint8_t) c < 0x20) || (c == 0x7f)) {
+        reportError( PROGMEM_ERR0, c, characterCounter );
         return false;
       } else {
         buffer[bufferPos] = c;
@@ -132,15 +266,13 @@ bool JsonStreamingParser::parse(char c) {
       } else if (c == '"') {
         startKey();
       } else {
-        sprintf_P( errorMessage, PROGMEM_ERR1, c, characterCounter );
-        myListener->error( errorMessage );
+        reportError( PROGMEM_ERR1, c, characterCounter );
         return false;
       }
       break;
     case STATE_END_KEY:
       if (c != ':') {
-        sprintf_P( errorMessage, PROGMEM_ERR2, c, characterCounter );
-        myListener->error( errorMessage );
+        reportError( PROGMEM_ERR2, c, characterCounter );
         return false;
       }
       state = STATE_AFTER_KEY;
@@ -155,10 +287,9 @@ bool JsonStreamingParser::parse(char c) {
       processUnicodeCharacter(c);
       break;
     case STATE_UNICODE_SURROGATE:
-      unicodeEscapeBuffer[unicodeEscapeBufferPos] = c;
-      unicodeEscapeBufferPos++;
-      if (unicodeEscapeBufferPos == 2) {
-        endUnicodeSurrogateInterstitial();
+      if (!processUnicodeSurrogateInterstitial(c)) {
+        // no low surrogate follows, c is parsed as usual
+        return parseChar(c);
       }
       break;
     case STATE_AFTER_VALUE: {
@@ -170,8 +301,7 @@ bool JsonStreamingParser::parse(char c) {
         } else if (c == ',') {
           state = STATE_IN_OBJECT;
         } else {
-          sprintf_P( errorMessage, PROGMEM_ERR3, c, characterCounter );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR3, c, characterCounter );
           return false;
         }
       } else if (within == STACK_ARRAY) {
@@ -180,13 +310,11 @@ bool JsonStreamingParser::parse(char c) {
         } else if (c == ',') {
           state = STATE_IN_ARRAY;
         } else {
-          sprintf_P( errorMessage, PROGMEM_ERR4, c, characterCounter );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR4, c, characterCounter );
           return false;
         }
       } else {
-          sprintf_P( errorMessage, PROGMEM_ERR5, characterCounter );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR5, characterCounter );
           return false;
       }
     }break;
@@ -196,20 +324,17 @@ bool JsonStreamingParser::parse(char c) {
         increaseBufferPointer();
       } else if (c == '.') {
         if (doesCharArrayContain(buffer, bufferPos, '.')) {
-          sprintf_P( errorMessage, PROGMEM_ERR6, characterCounter );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR6, characterCounter );
           return false;
         } else if (doesCharArrayContain(buffer, bufferPos, 'e')) {
-          sprintf_P( errorMessage, PROGMEM_ERR7, characterCounter );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR7, characterCounter );
           return false;
         }
         buffer[bufferPos] = c;
         increaseBufferPointer();
       } else if (c == 'e' || c == 'E') {
         if (doesCharArrayContain(buffer, bufferPos, 'e')) {
-          sprintf_P( errorMessage, PROGMEM_ERR8, characterCounter );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR8, characterCounter );
           return false;
         }
         buffer[bufferPos] = c;
@@ -217,8 +342,7 @@ bool JsonStreamingParser::parse(char c) {
       } else if (c == '+' || c == '-') {
         char last = buffer[bufferPos - 1];
         if (!(last == 'e' || last == 'E')) {
-          sprintf_P( errorMessage, PROGMEM_ERR9, characterCounter );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR9, characterCounter );
           return false;
         }
         buffer[bufferPos] = c;
@@ -226,7 +350,7 @@ bool JsonStreamingParser::parse(char c) {
       } else {
         endNumber();
         // we have consumed one beyond the end of the number
-        parse(c);
+        return parseChar(c);
       }
       break;
     case STATE_IN_TRUE:
@@ -257,52 +381,194 @@ bool JsonStreamingParser::parse(char c) {
       } else if (c == '{') {
         startObject();
       } else {
-          sprintf_P( errorMessage, PROGMEM_ERR10 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR10 );
           return false;        
       }
       break;
     }
     case STATE_DONE: {
-          sprintf_P( errorMessage, PROGMEM_ERR11 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR11 );
           return false;
     }
     default: {
-      sprintf_P( errorMessage, PROGMEM_ERR12, characterCounter );
-      myListener->error( errorMessage );
+      reportError( PROGMEM_ERR12, characterCounter );
       return false;      
     }
   }
 
     characterCounter++;
 
+    return state != STATE_ERROR;
+}
+
+void JsonStreamingParserBase::reportError(const char *format, ...) {
+  char errorMessage[ERROR_MAX_LENGTH];
+  va_list args;
+  va_start(args, format);
+  vsnprintf_P(errorMessage, ERROR_MAX_LENGTH, format, args);
+  va_end(args);
+  myListener->error( errorMessage );
+}
+
+boolean JsonStreamingParserBase::acquireBuffer() {
+  if (pool != NULL && buffer == NULL) {
+    buffer = pool->acquireScratch();
+  }
+  if (buffer == NULL) {
+    reportError( PROGMEM_ERR24, characterCounter );
+    // the token cannot be read, so nothing after it can be trusted
+    state = STATE_ERROR;
+    return false;
+  }
+  return true;
+}
+
+boolean JsonStreamingParserBase::push(uint8_t entry) {
+  if (stackPos == STACK_MAX_LENGTH) {
+    reportError( PROGMEM_ERR25, characterCounter );
+    // the structure of the rest of the document is unknown
+    state = STATE_ERROR;
+    return false;
+  }
+  stack[stackPos] = entry;
+  stackPos++;
+  return true;
+}
+
+boolean JsonStreamingParserBase::spillScratch() {
+  if (pool == NULL || buffer == NULL || !pool->isScratch(buffer)) {
+    return true;
+  }
+  if (state == STATE_ERROR) {
+    releaseBuffer();
     return true;
+  }
+  // the token continues in the next call, keep it in a side block so the
+  // scratch buffer is free for the other parsers in the meantime
+  char *block = pool->acquire();
+  if (block == NULL) {
+    releaseBuffer();
+    reportError( PROGMEM_ERR24, characterCounter );
+    state = STATE_ERROR;
+    return false;
+  }
+  memcpy(block, buffer, bufferPos);
+  pool->release(buffer);
+  buffer = block;
+  return true;
+}
+
+void JsonStreamingParserBase::releaseBuffer() {
+  if (pool != NULL && buffer != NULL) {
+    pool->release(buffer);
+    buffer = NULL;
+  }
+}
+
+void JsonStreamingParserBase::increaseBufferPointer() {
+  if (doChunkStrings && bufferPos + 1 == bufferLength - 1 && isInString()) {
+    bufferPos++;
+    flushStringChunk(false);
+    return;
+  }
+  bufferPos = min(bufferPos + 1, bufferLength - 1);
 }
 
-void JsonStreamingParser::increaseBufferPointer() {
-  bufferPos = min(bufferPos + 1, BUFFER_MAX_LENGTH - 1);
+boolean JsonStreamingParserBase::isInString() {
+  return stackPos > 0 && (stack[stackPos - 1] == STACK_KEY || stack[stackPos - 1] == STACK_STRING);
 }
 
-void JsonStreamingParser::endString() {
+boolean JsonStreamingParserBase::isCaptureStart(char c) {
+  if (state != STATE_IN_ARRAY && state != STATE_AFTER_KEY) {
+    return false;
+  }
+  return c == '[' || c == '{' || c == '"' || isDigit(c) || c == 't' || c == 'f' || c == 'n';
+}
+
+size_t JsonStreamingParserBase::captureRaw(const char *data, size_t length) {
+  if (state != STATE_CAPTURE) {
+    state = STATE_CAPTURE;
+    captureRequested = false;
+    captureInString = false;
+    captureEscape = false;
+    captureDepth = 0;
+  }
+  size_t end = length;
+  boolean done = false;
+  for (size_t i = 0; i < length && !done; i++) {
+    char c = data[i];
+    if (captureInString) {
+      if (captureEscape) {
+        captureEscape = false;
+      } else if (c == '\\') {
+        captureEscape = true;
+      } else if (c == '"') {
+        captureInString = false;
+        if (captureDepth == 0) {
+          end = i + 1;
+          done = true;
+        }
+      }
+    } else if (c == '"') {
+      captureInString = true;
+    } else if (c == '[' || c == '{') {
+      captureDepth++;
+    } else if (captureDepth == 0 && (c == ',' || c == ']' || c == '}'
+                                     || c == ' ' || c == '\t' || c == '\n' || c == '\r')) {
+      // end of a number or literal, the delimiter is not part of it
+      end = i;
+      done = true;
+    } else if (c == ']' || c == '}') {
+      captureDepth--;
+      if (captureDepth == 0) {
+        end = i + 1;
+        done = true;
+      }
+    }
+  }
+  myListener->rawValue(data, end, done);
+  if (done) {
+    state = STATE_AFTER_VALUE;
+  }
+  return end;
+}
+
+void JsonStreamingParserBase::flushStringChunk(boolean final) {
+  buffer[bufferPos] = '\0';
+  if (stack[stackPos - 1] == STACK_KEY) {
+    myListener->keyChunk(buffer, bufferPos, final);
+  } else {
+    myListener->valueChunk(buffer, bufferPos, final);
+  }
+  bufferPos = 0;
+}
+
+void JsonStreamingParserBase::endString() {
+    if (doChunkStrings && isInString()) {
+      flushStringChunk(true);
+    }
     int popped = stack[stackPos - 1];
     stackPos--;
     if (popped == STACK_KEY) {
-      buffer[bufferPos] = '\0';
-      myListener->key(buffer);
+      if (!doChunkStrings) {
+        buffer[bufferPos] = '\0';
+        myListener->key(buffer);
+      }
       state = STATE_END_KEY;
     } else if (popped == STACK_STRING) {
-      buffer[bufferPos] = '\0';
-      myListener->value(buffer);
+      if (!doChunkStrings) {
+        buffer[bufferPos] = '\0';
+        myListener->typedValue(buffer, VALUE_TYPE_STRING);
+      }
       state = STATE_AFTER_VALUE;
     } else {
-          sprintf_P( errorMessage, PROGMEM_ERR13 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR13 );
           return;       
     }
     bufferPos = 0;
+    releaseBuffer();
   }
-void JsonStreamingParser::startValue(char c) {
+void JsonStreamingParserBase::startValue(char c) {
     if (c == '[') {
       startArray();
     } else if (c == '{') {
@@ -312,35 +578,42 @@ void JsonStreamingParser::startValue(char c) {
     } else if (isDigit(c)) {
       startNumber(c);
     } else if (c == 't') {
+      if (!acquireBuffer()) {
+        return;
+      }
       state = STATE_IN_TRUE;
       buffer[bufferPos] = c;
       increaseBufferPointer();
     } else if (c == 'f') {
+      if (!acquireBuffer()) {
+        return;
+      }
       state = STATE_IN_FALSE;
       buffer[bufferPos] = c;
       increaseBufferPointer();
     } else if (c == 'n') {
+      if (!acquireBuffer()) {
+        return;
+      }
       state = STATE_IN_NULL;
       buffer[bufferPos] = c;
       increaseBufferPointer();
     } else {
-          sprintf_P( errorMessage, PROGMEM_ERR14 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR14 );
           return;    
     }
   }
 
-boolean JsonStreamingParser::isDigit(char c) {
+boolean JsonStreamingParserBase::isDigit(char c) {
     // Only concerned with the first character in a number.
     return (c >= '0' && c <= '9') || c == '-';
   }
 
-void JsonStreamingParser::endArray() {
+void JsonStreamingParserBase::endArray() {
     int popped = stack[stackPos - 1];
     stackPos--;
     if (popped != STACK_ARRAY) {
-          sprintf_P( errorMessage, PROGMEM_ERR15 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR15 );
           return;
     }
     myListener->endArray();
@@ -350,28 +623,28 @@ void JsonStreamingParser::endArray() {
     }
   }
 
-void JsonStreamingParser::startKey() {
-    stack[stackPos] = STACK_KEY;
-    stackPos++;
+void JsonStreamingParserBase::startKey() {
+    if (!push(STACK_KEY) || !acquireBuffer()) {
+      return;
+    }
     state = STATE_IN_STRING;
   }
 
-void JsonStreamingParser::endObject() {
-    int popped = stack[stackPos];
+void JsonStreamingParserBase::endObject() {
+    int popped = stack[stackPos - 1];
     stackPos--;
     if (popped != STACK_OBJECT) {
-          sprintf_P( errorMessage, PROGMEM_ERR16 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR16 );
           return;
     }
     myListener->endObject();
     state = STATE_AFTER_VALUE;
-    if (stackPos == -1) {
+    if (stackPos == 0) {
       endDocument();
     }
   }
 
-void JsonStreamingParser::processEscapeCharacters(char c) {
+void JsonStreamingParserBase::processEscapeCharacters(char c) {
     if (c == '"') {
       buffer[bufferPos] = '"';
       increaseBufferPointer();
@@ -399,8 +672,7 @@ void JsonStreamingParser::processEscapeCharacters(char c) {
     } else if (c == 'u') {
       state = STATE_UNICODE;
     } else {
-          sprintf_P( errorMessage, PROGMEM_ERR17 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR17 );
           return;      
     }
     if (state != STATE_UNICODE) {
@@ -408,64 +680,57 @@ void JsonStreamingParser::processEscapeCharacters(char c) {
     }
   }
 
-void JsonStreamingParser::processUnicodeCharacter(char c) {
+void JsonStreamingParserBase::processUnicodeCharacter(char c) {
     if (!isHexCharacter(c)) {
-          sprintf_P( errorMessage, PROGMEM_ERR18 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR18 );
           return;      
     }
 
-    unicodeBuffer[unicodeBufferPos] = c;
+    unicodeValue = (unicodeValue << 4) | getHexValue(c);
     unicodeBufferPos++;
 
     if (unicodeBufferPos == 4) {
-      int codepoint = getHexArrayAsDecimal(unicodeBuffer, unicodeBufferPos);
-      endUnicodeCharacter(codepoint);
-      return;
-      /*if (codepoint >= 0xD800 && codepoint < 0xDC00) {
+      long codepoint = unicodeValue;
+      unicodeValue = 0;
+      unicodeBufferPos = 0;
+      if (codepoint >= 0xD800 && codepoint < 0xDC00) {
+        if (unicodeHighSurrogate != 0) {
+          // two high surrogates in a row, the first one has no partner
+          appendCodepoint(0xFFFD);
+        }
         unicodeHighSurrogate = codepoint;
-        unicodeBufferPos = 0;
         state = STATE_UNICODE_SURROGATE;
       } else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
-        if (unicodeHighSurrogate == -1) {
-          // throw new ParsingError($this->_line_number,
-          // $this->_char_number,
-          // "Missing high surrogate for Unicode low surrogate.");
+        if (unicodeHighSurrogate == 0) {
+          // low surrogate without a high surrogate
+          endUnicodeCharacter(0xFFFD);
+        } else {
+          long combinedCodePoint = (((long) unicodeHighSurrogate - 0xD800) << 10) + (codepoint - 0xDC00) + 0x10000;
+          endUnicodeCharacter(combinedCodePoint);
         }
-        int combinedCodePoint = ((unicodeHighSurrogate - 0xD800) * 0x400) + (codepoint - 0xDC00) + 0x10000;
-        endUnicodeCharacter(combinedCodePoint);
-      } else if (unicodeHighSurrogate != -1) {
-        // throw new ParsingError($this->_line_number,
-        // $this->_char_number,
-        // "Invalid low surrogate following Unicode high surrogate.");
-        endUnicodeCharacter(codepoint);
       } else {
+        if (unicodeHighSurrogate != 0) {
+          // high surrogate followed by something other than a low surrogate
+          appendCodepoint(0xFFFD);
+        }
         endUnicodeCharacter(codepoint);
-      }*/
+      }
     }
   }
-boolean JsonStreamingParser::isHexCharacter(char c) {
+boolean JsonStreamingParserBase::isHexCharacter(char c) {
     return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
   }
 
-int JsonStreamingParser::getHexArrayAsDecimal(char hexArray[], int length) {
-    int result = 0;
-    for (int i = 0; i < length; i++) {
-      char current = hexArray[length - i - 1];
-      int value = 0;
-      if (current >= 'a' && current <= 'f') {
-        value = current - 'a' + 10;
-      } else if (current >= 'A' && current <= 'F') {
-        value = current - 'A' + 10;
-      } else if (current >= '0' && current <= '9') {
-        value = current - '0';
-      }
-      result += value * 16^i;
+int JsonStreamingParserBase::getHexValue(char c) {
+    if (c >= 'a' && c <= 'f') {
+      return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      return c - 'A' + 10;
     }
-    return result;
+    return c - '0';
   }
 
-boolean JsonStreamingParser::doesCharArrayContain(char myArray[], int length, char c) {
+boolean JsonStreamingParserBase::doesCharArrayContain(char myArray[], int length, char c) {
     for (int i = 0; i < length; i++) {
       if (myArray[i] == c) {
         return true;
@@ -474,26 +739,35 @@ boolean JsonStreamingParser::doesCharArrayContain(char myArray[], int length, ch
     return false;
   }
 
-void JsonStreamingParser::endUnicodeSurrogateInterstitial() {
-    char unicodeEscape = unicodeEscapeBuffer[unicodeEscapeBufferPos - 1];
-    if (unicodeEscape != 'u') {
-          sprintf_P( errorMessage, PROGMEM_ERR19 );
-          myListener->error( errorMessage );
-          return;          
+boolean JsonStreamingParserBase::processUnicodeSurrogateInterstitial(char c) {
+    if (unicodeEscapeBufferPos == 0 && c == '\\') {
+      unicodeEscapeBufferPos = 1;
+      return true;
     }
-    unicodeBufferPos = 0;
+    if (unicodeEscapeBufferPos == 1 && c == 'u') {
+      unicodeEscapeBufferPos = 0;
+      unicodeBufferPos = 0;
+      state = STATE_UNICODE;
+      return true;
+    }
+    // high surrogate without a low surrogate, continue with the string or
+    // the escape sequence that follows it
+    state = unicodeEscapeBufferPos == 1 ? STATE_START_ESCAPE : STATE_IN_STRING;
     unicodeEscapeBufferPos = 0;
-    state = STATE_UNICODE;
+    unicodeHighSurrogate = 0;
+    appendCodepoint(0xFFFD);
+    return false;
   }
 
-void JsonStreamingParser::endNumber() {
+void JsonStreamingParserBase::endNumber() {
     buffer[bufferPos] = '\0';
-    myListener->value(buffer);
+    myListener->typedValue(buffer, VALUE_TYPE_NUMBER);
     bufferPos = 0;
+    releaseBuffer();
     state = STATE_AFTER_VALUE;
   }
 
-int JsonStreamingParser::convertDecimalBufferToInt(char myArray[], int length) {
+int JsonStreamingParserBase::convertDecimalBufferToInt(char myArray[], int length) {
     int result = 0;
     for (int i = 0; i < length; i++) {
       char current = myArray[length - i - 1];
@@ -502,94 +776,164 @@ int JsonStreamingParser::convertDecimalBufferToInt(char myArray[], int length) {
     return result;
   }
 
-void JsonStreamingParser::endDocument() {
+void JsonStreamingParserBase::endDocument() {
     myListener->endDocument();
     state = STATE_DONE;
   }
 
-void JsonStreamingParser::endTrue() {
+void JsonStreamingParserBase::endTrue() {
     buffer[bufferPos] = '\0';
     // String value = String(buffer);
     if (strncmp(buffer, "true", 4) == 0) {
-      myListener->value("true");
+      myListener->typedValue("true", VALUE_TYPE_TRUE);
     } else {
-          sprintf_P( errorMessage, PROGMEM_ERR20 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR20 );
           return;              
     }
     bufferPos = 0;
+    releaseBuffer();
     state = STATE_AFTER_VALUE;
   }
 
-void JsonStreamingParser::endFalse() {
+void JsonStreamingParserBase::endFalse() {
     buffer[bufferPos] = '\0';
     // String value = String(buffer);
     if (strncmp(buffer, "false",5) == 0 ) {
-      myListener->value("false");
+      myListener->typedValue("false", VALUE_TYPE_FALSE);
     } else {
-          sprintf_P( errorMessage, PROGMEM_ERR21 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR21 );
           return;              
     }
     bufferPos = 0;
+    releaseBuffer();
     state = STATE_AFTER_VALUE;
   }
 
-void JsonStreamingParser::endNull() {
+void JsonStreamingParserBase::endNull() {
     buffer[bufferPos] = '\0';
     // String value = String(buffer);
     if (strncmp(buffer, "null", 4) == 0) {
-      myListener->value("null");
+      myListener->typedValue("null", VALUE_TYPE_NULL);
     } else {
-          sprintf_P( errorMessage, PROGMEM_ERR22 );
-          myListener->error( errorMessage );
+          reportError( PROGMEM_ERR22 );
           return;              
     }
     bufferPos = 0;
+    releaseBuffer();
     state = STATE_AFTER_VALUE;
   }
 
-void JsonStreamingParser::startArray() {
+void JsonStreamingParserBase::startArray() {
+    if (!push(STACK_ARRAY)) {
+      return;
+    }
     myListener->startArray();
     state = STATE_IN_ARRAY;
-    stack[stackPos] = STACK_ARRAY;
-    stackPos++;
   }
 
-void JsonStreamingParser::startObject() {
+void JsonStreamingParserBase::startObject() {
+    if (!push(STACK_OBJECT)) {
+      return;
+    }
     myListener->startObject();
     state = STATE_IN_OBJECT;
-    stack[stackPos] = STACK_OBJECT;
-    stackPos++;
   }
 
-void JsonStreamingParser::startString() {
-    stack[stackPos] = STACK_STRING;
-    stackPos++;
+void JsonStreamingParserBase::startString() {
+    if (!push(STACK_STRING) || !acquireBuffer()) {
+      return;
+    }
     state = STATE_IN_STRING;
   }
 
-void JsonStreamingParser::startNumber(char c) {
+void JsonStreamingParserBase::startNumber(char c) {
+    if (!acquireBuffer()) {
+      return;
+    }
     state = STATE_IN_NUMBER;
     buffer[bufferPos] = c;
     increaseBufferPointer();
   }
 
-void JsonStreamingParser::endUnicodeCharacter(int codepoint) {
-    buffer[bufferPos] = convertCodepointToCharacter(codepoint);
-    increaseBufferPointer();
+void JsonStreamingParserBase::endUnicodeCharacter(long codepoint) {
+    appendCodepoint(codepoint);
     unicodeBufferPos = 0;
-    unicodeHighSurrogate = -1;
+    unicodeHighSurrogate = 0;
     state = STATE_IN_STRING;
   }
 
-char JsonStreamingParser::convertCodepointToCharacter(int num) {
-    if (num <= 0x7F)
-      return (char) (num);
-    // if(num<=0x7FF) return (char)((num>>6)+192) + (char)((num&63)+128);
-    // if(num<=0xFFFF) return
-    // chr((num>>12)+224).chr(((num>>6)&63)+128).chr((num&63)+128);
-    // if(num<=0x1FFFFF) return
-    // chr((num>>18)+240).chr(((num>>12)&63)+128).chr(((num>>6)&63)+128).chr((num&63)+128);
-    return ' ';
+void JsonStreamingParserBase::appendCodepoint(long codepoint) {
+    char encoded[4];
+    int length;
+    if (codepoint <= 0x7F) {
+      encoded[0] = (char) codepoint;
+      length = 1;
+    } else if (codepoint <= 0x7FF) {
+      encoded[0] = (char) (0xC0 | (codepoint >> 6));
+      encoded[1] = (char) (0x80 | (codepoint & 0x3F));
+      length = 2;
+    } else if (codepoint <= 0xFFFF) {
+      encoded[0] = (char) (0xE0 | (codepoint >> 12));
+      encoded[1] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+      encoded[2] = (char) (0x80 | (codepoint & 0x3F));
+      length = 3;
+    } else {
+      encoded[0] = (char) (0xF0 | (codepoint >> 18));
+      encoded[1] = (char) (0x80 | ((codepoint >> 12) & 0x3F));
+      encoded[2] = (char) (0x80 | ((codepoint >> 6) & 0x3F));
+      encoded[3] = (char) (0x80 | (codepoint & 0x3F));
+      length = 4;
+    }
+    if (bufferPos + length > bufferLength - 1) {
+      if (!doChunkStrings) {
+        // drop characters that do not fit as a whole rather than cutting a sequence
+        return;
+      }
+      flushStringChunk(false);
+    }
+    for (int i = 0; i < length; i++) {
+      buffer[bufferPos] = encoded[i];
+      increaseBufferPointer();
+    }
+  }
+
+boolean JsonStreamingParserBase::validateUtf8Byte(uint8_t b) {
+    if (utf8Remaining > 0) {
+      if (b < utf8Lower || b > utf8Upper) {
+        utf8Remaining = 0;
+        utf8Lower = 0x80;
+        utf8Upper = 0xBF;
+        return false;
+      }
+      utf8Remaining--;
+      utf8Lower = 0x80;
+      utf8Upper = 0xBF;
+      return true;
+    }
+    // lead byte; the first continuation byte range rules out overlong
+    // encodings, surrogates and code points above U+10FFFF
+    if (b < 0x80) {
+      return true;
+    } else if (b >= 0xC2 && b <= 0xDF) {
+      utf8Remaining = 1;
+    } else if (b == 0xE0) {
+      utf8Remaining = 2;
+      utf8Lower = 0xA0;
+    } else if (b == 0xED) {
+      utf8Remaining = 2;
+      utf8Upper = 0x9F;
+    } else if (b >= 0xE1 && b <= 0xEF) {
+      utf8Remaining = 2;
+    } else if (b == 0xF0) {
+      utf8Remaining = 3;
+      utf8Lower = 0x90;
+    } else if (b >= 0xF1 && b <= 0xF3) {
+      utf8Remaining = 3;
+    } else if (b == 0xF4) {
+      utf8Remaining = 3;
+      utf8Upper = 0x8F;
+    } else {
+      return false;
+    }
+    return true;
   }
@@ -31,12 +31,14 @@ See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-p
 #include "MockArduino.h"
 #endif
 #include "JsonListener.h"
+#include "JsonBufferPool.h"
 
 /** Define this to enable verbose erroring. You may not want this on flash-constrained platforms */
 #define USE_LONG_ERRORS 1
 
 #define STATE_START_DOCUMENT     0
 #define STATE_DONE               -1
+#define STATE_ERROR              -2
 #define STATE_IN_ARRAY           1
 #define STATE_IN_OBJECT          2
 #define STATE_END_KEY            3
@@ -50,6 +52,7 @@ See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-p
 #define STATE_IN_NULL            11
 #define STATE_AFTER_VALUE        12
 #define STATE_UNICODE_SURROGATE  13
+#define STATE_CAPTURE            14
 
 #define STACK_OBJECT             0
 #define STACK_ARRAY              1
@@ -57,35 +60,88 @@ See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-p
 #define STACK_STRING             3
 
 #define BUFFER_MAX_LENGTH  512
-
-class JsonStreamingParser {
+#define STACK_MAX_LENGTH   20
+#define ERROR_MAX_LENGTH   128
+
+/**
+ * The parser itself. Create a JsonStreamingParser, which owns its token
+ * buffer, or a JsonPooledParser, which borrows token buffers from a
+ * JsonBufferPool; code that works with either takes a
+ * JsonStreamingParserBase.
+ */
+class JsonStreamingParserBase {
   private:
+    // Members are ordered largest first so that an idle parser stays small,
+    // see JsonBufferPool.
+    JsonListener* myListener;
 
+    long characterCounter = 0;
 
-    int state;
-    int stack[20];
-    int stackPos = 0;
-    JsonListener* myListener;
+    // token buffer, either owned by the parser or borrowed from the pool
+    // while a token is being read, see JsonPooledParser
+    char* buffer = NULL;
+    JsonBufferPool* pool = NULL;
+    uint16_t bufferLength = 0;
+    uint16_t bufferPos = 0;
+
+    // 0 if no high surrogate is pending
+    uint16_t unicodeHighSurrogate = 0;
+    // hex digits of the \u escape read so far
+    uint16_t unicodeValue = 0;
+
+    // raw capture of a value, see captureNextValue()
+    uint16_t captureDepth = 0;
+
+    uint8_t stackPos = 0;
+    uint8_t stack[STACK_MAX_LENGTH];
+    int8_t state;
+
+    // 1 after the '\' of a possible low surrogate escape
+    uint8_t unicodeEscapeBufferPos = 0;
+    uint8_t unicodeBufferPos = 0;
 
-    boolean doEmitWhitespace = false;
-    // fixed length buffer array to prepare for c code
-    char buffer[BUFFER_MAX_LENGTH];
-    int bufferPos = 0;
+    // continuation bytes still expected and their valid range
+    uint8_t utf8Remaining = 0;
+    uint8_t utf8Lower = 0x80;
+    uint8_t utf8Upper = 0xBF;
 
-    char unicodeEscapeBuffer[10];
-    int unicodeEscapeBufferPos = 0;
+    // options and capture flags, one bit each; set in the constructor
+    boolean doChunkStrings : 1;
+    boolean doValidateUtf8 : 1;
+    boolean captureRequested : 1;
+    boolean captureInString : 1;
+    boolean captureEscape : 1;
 
-    char unicodeBuffer[10];
-    int unicodeBufferPos = 0;
+    // not copyable, the buffer belongs to the derived class or the pool
+    JsonStreamingParserBase(const JsonStreamingParserBase&);
+    JsonStreamingParserBase& operator=(const JsonStreamingParserBase&);
 
-    int characterCounter = 0;
+    void reportError(const char *format, ...);
 
-    int unicodeHighSurrogate = 0;
+    boolean parseChar(char c);
 
-    char errorMessage[128];
+    boolean acquireBuffer();
+
+    // Moves a token that is still being read at the end of a parse() call
+    // from the pool's scratch buffer to a side block
+    boolean spillScratch();
+
+    // Pushes a container, key or string onto the stack; reports an error
+    // and stops parsing if the document is nested too deeply
+    boolean push(uint8_t entry);
+
+    void releaseBuffer();
 
     void increaseBufferPointer();
 
+    boolean isInString();
+
+    boolean isCaptureStart(char c);
+
+    size_t captureRaw(const char *data, size_t length);
+
+    void flushStringChunk(boolean final);
+
     void endString();
 
     void endArray();
@@ -100,9 +156,11 @@ class JsonStreamingParser {
 
     boolean isHexCharacter(char c);
 
-    char convertCodepointToCharacter(int num);
+    void appendCodepoint(long codepoint);
 
-    void endUnicodeCharacter(int codepoint);
+    boolean validateUtf8Byte(uint8_t b);
+
+    void endUnicodeCharacter(long codepoint);
 
     void startNumber(char c);
 
@@ -124,11 +182,11 @@ class JsonStreamingParser {
 
     void endNumber();
 
-    void endUnicodeSurrogateInterstitial();
+    boolean processUnicodeSurrogateInterstitial(char c);
 
     boolean doesCharArrayContain(char myArray[], int length, char c);
 
-    int getHexArrayAsDecimal(char hexArray[], int length);
+    int getHexValue(char c);
 
     void processUnicodeCharacter(char c);
 
@@ -136,9 +194,78 @@ class JsonStreamingParser {
 
 
 
+  protected:
+    // buffer is NULL if the tokens are read into buffers borrowed from pool
+    JsonStreamingParserBase(char* buffer, uint16_t bufferLength, JsonBufferPool* pool);
+    ~JsonStreamingParserBase();
+
   public:
-    JsonStreamingParser();
     bool parse(char c);
+    // Parse a chunk of input, e.g. what a client has available right now
+    bool parse(const char *data, size_t length);
     void setListener(JsonListener* listener);
     void reset();
+
+    // Deliver keys and string values in pieces through keyChunk() and
+    // valueChunk() instead of key() and value(). A piece is handed out
+    // whenever the token buffer is full and at the end of every parse()
+    // call on a chunk of input, so strings of any length can be processed.
+    void setStringChunking(boolean chunk);
+
+    // Called from key() or startArray(): instead of parsing the value that
+    // follows, hand its bytes to the listener's rawValue() exactly as they
+    // appear in the input. If no value follows directly (an empty array, or
+    // a call from anywhere else) the request is dropped.
+    // No other events are fired for anything inside that value and it is not
+    // validated beyond finding its end. With parse(const char*, size_t) a
+    // value within one input chunk arrives as a single slice.
+    void captureNextValue();
+
+    // Reject strings which contain malformed UTF-8, overlong encodings or
+    // encoded surrogates. Off by default.
+    void setValidateUtf8(boolean validate);
+
+    // Byte offset of the next character to be parsed, counting whitespace
+    long getPosition();
+
+    // Number of open containers; getContainer(0) is the outermost one
+    // and returns STACK_OBJECT or STACK_ARRAY
+    int getDepth();
+    int getContainer(int level);
+
+    // True right after '[', '{' or a separating ',', i.e. where the parser
+    // can be stopped and later resumed with resumeAt()
+    boolean isAtValueBoundary();
+
+    // Continue a document in the middle: the next character is expected to
+    // start a value (inside an array) or a key (inside an object) nested in
+    // the given containers. position is only used for getPosition() and
+    // error messages. startDocument() is not fired for a resumed document.
+    // depth must be between 1 and STACK_MAX_LENGTH - 1, since the stack also
+    // holds the key or string being read.
+    boolean resumeAt(const int containers[], int depth, long position);
+};
+
+/**
+ * The parser as it always was: owns a token buffer of BUFFER_MAX_LENGTH
+ * bytes.
+ */
+class JsonStreamingParser: public JsonStreamingParserBase {
+  private:
+    char ownBuffer[BUFFER_MAX_LENGTH];
+
+  public:
+    JsonStreamingParser();
+};
+
+/**
+ * Parser that borrows token buffers from a JsonBufferPool instead of owning
+ * one. Tokens are read into the pool's scratch buffer; only a token that is
+ * not finished at the end of a parse() call is copied to a side block,
+ * which it keeps until the token ends. An idle parser needs only a few
+ * dozen bytes.
+ */
+class JsonPooledParser: public JsonStreamingParserBase {
+  public:
+    JsonPooledParser(JsonBufferPool* pool);
 };
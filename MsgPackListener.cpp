@@ -0,0 +1,326 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#include "MsgPackListener.h"
+
+#define MSGPACK_NIL              0xc0
+#define MSGPACK_FALSE            0xc2
+#define MSGPACK_TRUE             0xc3
+#define MSGPACK_FLOAT32          0xca
+#define MSGPACK_FLOAT64          0xcb
+#define MSGPACK_UINT8            0xcc
+#define MSGPACK_UINT16           0xcd
+#define MSGPACK_UINT32           0xce
+#define MSGPACK_UINT64           0xcf
+#define MSGPACK_INT8             0xd0
+#define MSGPACK_INT16            0xd1
+#define MSGPACK_INT32            0xd2
+#define MSGPACK_INT64            0xd3
+#define MSGPACK_FIXSTR           0xa0
+#define MSGPACK_STR8             0xd9
+#define MSGPACK_STR16            0xda
+#define MSGPACK_STR32            0xdb
+#define MSGPACK_ARRAY32          0xdd
+#define MSGPACK_MAP32            0xdf
+
+MsgPackChunkedBuffer::MsgPackChunkedBuffer(uint8_t *chunks[], int chunkCount, size_t chunkLength) {
+  this->chunks = chunks;
+  this->chunkCount = chunkCount;
+  this->chunkLength = chunkLength;
+}
+
+boolean MsgPackChunkedBuffer::write(const uint8_t *data, size_t length) {
+  if (length > chunkCount * chunkLength - this->length) {
+    return false;
+  }
+  while (length > 0) {
+    size_t offset = this->length % chunkLength;
+    size_t piece = min(length, chunkLength - offset);
+    memcpy(chunks[this->length / chunkLength] + offset, data, piece);
+    data += piece;
+    length -= piece;
+    this->length += piece;
+  }
+  return true;
+}
+
+boolean MsgPackChunkedBuffer::patch(size_t position, const uint8_t *data, size_t length) {
+  if (position > this->length || length > this->length - position) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++) {
+    chunks[(position + i) / chunkLength][(position + i) % chunkLength] = data[i];
+  }
+  return true;
+}
+
+size_t MsgPackChunkedBuffer::getLength() {
+  return length;
+}
+
+void MsgPackChunkedBuffer::clear() {
+  length = 0;
+}
+
+MsgPackListener::MsgPackListener(MsgPackOutput* output) {
+  this->output = output;
+}
+
+size_t MsgPackListener::getBytesWritten() {
+  return bytesWritten;
+}
+
+boolean MsgPackListener::hasFailed() {
+  return failed;
+}
+
+void MsgPackListener::flush() {
+  if (bufferPos > 0 && !failed && !output->write(buffer, bufferPos)) {
+    failed = true;
+  }
+  bufferPos = 0;
+}
+
+void MsgPackListener::writeBytes(const uint8_t *data, size_t length) {
+  if (bufferPos + length > MSGPACK_BUFFER_LENGTH) {
+    flush();
+    if (length >= MSGPACK_BUFFER_LENGTH) {
+      // large strings bypass the buffer
+      if (!failed && !output->write(data, length)) {
+        failed = true;
+      }
+      bytesWritten += length;
+      return;
+    }
+  }
+  memcpy(buffer + bufferPos, data, length);
+  bufferPos += length;
+  bytesWritten += length;
+}
+
+void MsgPackListener::writeByte(uint8_t b) {
+  writeBytes(&b, 1);
+}
+
+void MsgPackListener::writeBigEndian(uint8_t type, uint64_t value, int length) {
+  uint8_t bytes[9];
+  bytes[0] = type;
+  for (int i = 0; i < length; i++) {
+    bytes[length - i] = (uint8_t) (value >> (8 * i));
+  }
+  writeBytes(bytes, length + 1);
+}
+
+void MsgPackListener::writeString(const char *value) {
+  size_t length = strlen(value);
+  if (length < 32) {
+    writeByte(MSGPACK_FIXSTR | length);
+  } else if (length <= 0xff) {
+    writeBigEndian(MSGPACK_STR8, length, 1);
+  } else if (length <= 0xffff) {
+    writeBigEndian(MSGPACK_STR16, length, 2);
+  } else {
+    writeBigEndian(MSGPACK_STR32, length, 4);
+  }
+  writeBytes((const uint8_t *) value, length);
+}
+
+boolean MsgPackListener::parseInteger(const char *value, uint64_t *magnitude, boolean *negative) {
+  const char *c = value;
+  *negative = (*c == '-');
+  if (*negative) {
+    c++;
+  }
+  uint64_t result = 0;
+  for (; *c != '\0'; c++) {
+    if (*c < '0' || *c > '9') {
+      // fraction or exponent
+      return false;
+    }
+    uint64_t digit = *c - '0';
+    if (result > (UINT64_MAX - digit) / 10) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+  if (*negative && result == 0) {
+    // -0 is just 0 for integers
+    *negative = false;
+  }
+  *magnitude = result;
+  return true;
+}
+
+void MsgPackListener::writeNumber(const char *value) {
+  uint64_t magnitude;
+  boolean negative;
+  if (parseInteger(value, &magnitude, &negative)) {
+    if (!negative) {
+      if (magnitude < 0x80) {
+        writeByte((uint8_t) magnitude);
+      } else if (magnitude <= 0xff) {
+        writeBigEndian(MSGPACK_UINT8, magnitude, 1);
+      } else if (magnitude <= 0xffff) {
+        writeBigEndian(MSGPACK_UINT16, magnitude, 2);
+      } else if (magnitude <= 0xffffffffUL) {
+        writeBigEndian(MSGPACK_UINT32, magnitude, 4);
+      } else {
+        writeBigEndian(MSGPACK_UINT64, magnitude, 8);
+      }
+      return;
+    }
+    if (magnitude <= 32) {
+      // negative fixint, the byte is the two's complement of -magnitude
+      writeByte((uint8_t) (0x100 - magnitude));
+      return;
+    } else if (magnitude <= 0x80) {
+      writeBigEndian(MSGPACK_INT8, (uint64_t) 0 - magnitude, 1);
+      return;
+    } else if (magnitude <= 0x8000) {
+      writeBigEndian(MSGPACK_INT16, (uint64_t) 0 - magnitude, 2);
+      return;
+    } else if (magnitude <= 0x80000000UL) {
+      writeBigEndian(MSGPACK_INT32, (uint64_t) 0 - magnitude, 4);
+      return;
+    } else if (magnitude <= 0x8000000000000000ULL) {
+      writeBigEndian(MSGPACK_INT64, (uint64_t) 0 - magnitude, 8);
+      return;
+    }
+    // below the int64 range, fall back to a float
+  }
+  writeFloat(strtod(value, NULL));
+}
+
+void MsgPackListener::writeFloat(double number) {
+  float single = (float) number;
+  if ((double) single == number || number != number || sizeof(double) != sizeof(uint64_t)) {
+    uint32_t bits;
+    memcpy(&bits, &single, sizeof(bits));
+    writeBigEndian(MSGPACK_FLOAT32, bits, 4);
+    return;
+  }
+  uint64_t bits;
+  memcpy(&bits, &number, sizeof(bits));
+  writeBigEndian(MSGPACK_FLOAT64, bits, 8);
+}
+
+void MsgPackListener::countElement(boolean isKey) {
+  if (depth > 0 && depth <= STACK_MAX_LENGTH && containerIsMap[depth - 1] == isKey) {
+    containerCount[depth - 1]++;
+  }
+}
+
+void MsgPackListener::startContainer(boolean isMap) {
+  countElement(false);
+  if (depth < STACK_MAX_LENGTH) {
+    containerPosition[depth] = bytesWritten;
+    containerCount[depth] = 0;
+    containerIsMap[depth] = isMap;
+  }
+  depth++;
+  // the size is filled in by endContainer()
+  writeBigEndian(isMap ? MSGPACK_MAP32 : MSGPACK_ARRAY32, 0, 4);
+}
+
+void MsgPackListener::endContainer() {
+  if (depth == 0) {
+    return;
+  }
+  depth--;
+  if (depth >= STACK_MAX_LENGTH) {
+    failed = true;
+    return;
+  }
+  // the header may still be in the buffer
+  flush();
+  if (failed) {
+    return;
+  }
+  uint8_t size[4];
+  for (int i = 0; i < 4; i++) {
+    size[i] = (uint8_t) (containerCount[depth] >> (24 - 8 * i));
+  }
+  if (!output->patch(containerPosition[depth] + 1, size, 4)) {
+    failed = true;
+  }
+}
+
+void MsgPackListener::whitespace(char c) {
+}
+
+void MsgPackListener::startDocument() {
+  bytesWritten = 0;
+  bufferPos = 0;
+  depth = 0;
+  failed = false;
+}
+
+void MsgPackListener::key(const char *key) {
+  countElement(true);
+  writeString(key);
+}
+
+void MsgPackListener::value(const char *value) {
+  typedValue(value, VALUE_TYPE_STRING);
+}
+
+void MsgPackListener::typedValue(const char *value, int type) {
+  countElement(false);
+  if (type == VALUE_TYPE_NUMBER) {
+    writeNumber(value);
+  } else if (type == VALUE_TYPE_TRUE) {
+    writeByte(MSGPACK_TRUE);
+  } else if (type == VALUE_TYPE_FALSE) {
+    writeByte(MSGPACK_FALSE);
+  } else if (type == VALUE_TYPE_NULL) {
+    writeByte(MSGPACK_NIL);
+  } else {
+    writeString(value);
+  }
+}
+
+void MsgPackListener::endArray() {
+  endContainer();
+}
+
+void MsgPackListener::endObject() {
+  endContainer();
+}
+
+void MsgPackListener::endDocument() {
+  flush();
+}
+
+void MsgPackListener::startArray() {
+  startContainer(false);
+}
+
+void MsgPackListener::startObject() {
+  startContainer(true);
+}
+
+void MsgPackListener::error( const char *message ) {
+  flush();
+}
@@ -0,0 +1,157 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+#pragma once
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include "MockArduino.h"
+#endif
+#include "JsonListener.h"
+#include "JsonStreamingParser.h"
+
+#define MSGPACK_BUFFER_LENGTH  64
+
+/**
+ * Destination for MsgPackListener. Unlike a Print it must let bytes that
+ * were already written be overwritten, since the size of an array or map is
+ * only known once it is closed. A File that can seek() is easily adapted.
+ */
+class MsgPackOutput {
+  public:
+    // Both return false if the bytes could not be stored
+    virtual boolean write(const uint8_t *data, size_t length) = 0;
+
+    // Overwrites length bytes at position, counted from the first byte
+    // ever written
+    virtual boolean patch(size_t position, const uint8_t *data, size_t length) = 0;
+};
+
+/**
+ * MsgPackOutput that fills a list of equally sized chunks of memory provided
+ * by the caller, so the output does not need one large contiguous block.
+ */
+class MsgPackChunkedBuffer: public MsgPackOutput {
+  private:
+    uint8_t **chunks;
+    int chunkCount;
+    size_t chunkLength;
+    size_t length = 0;
+
+  public:
+    MsgPackChunkedBuffer(uint8_t *chunks[], int chunkCount, size_t chunkLength);
+
+    virtual boolean write(const uint8_t *data, size_t length);
+
+    virtual boolean patch(size_t position, const uint8_t *data, size_t length);
+
+    // Number of bytes written; they fill the chunks in order
+    size_t getLength();
+
+    // Starts over with an empty buffer
+    void clear();
+};
+
+/**
+ * Listener that transcodes the parser events to MessagePack on the fly.
+ * Arrays and maps are written with a 32 bit size that is filled in when
+ * they are closed, so besides a small output buffer only the position of
+ * every open container is kept in memory. Numbers are written in the smallest integer or float
+ * form that represents them exactly, strings in the smallest str form.
+ */
+class MsgPackListener: public JsonListener {
+  private:
+    MsgPackOutput* output;
+
+    // header position and number of elements of every open container
+    size_t containerPosition[STACK_MAX_LENGTH];
+    uint32_t containerCount[STACK_MAX_LENGTH];
+    boolean containerIsMap[STACK_MAX_LENGTH];
+    int depth = 0;
+
+    // bytes not yet handed to the output
+    uint8_t buffer[MSGPACK_BUFFER_LENGTH];
+    int bufferPos = 0;
+
+    size_t bytesWritten = 0;
+    boolean failed = false;
+
+    void writeBytes(const uint8_t *data, size_t length);
+
+    void writeByte(uint8_t b);
+
+    void writeBigEndian(uint8_t type, uint64_t value, int length);
+
+    void writeString(const char *value);
+
+    void writeNumber(const char *value);
+
+    void writeFloat(double number);
+
+    boolean parseInteger(const char *value, uint64_t *magnitude, boolean *negative);
+
+    void countElement(boolean isKey);
+
+    void startContainer(boolean isMap);
+
+    void endContainer();
+
+  public:
+    MsgPackListener(MsgPackOutput* output);
+
+    // Hands the buffered bytes to the output. Called at the end of the
+    // document and before sizes are filled in.
+    void flush();
+
+    // Total number of MessagePack bytes produced so far
+    size_t getBytesWritten();
+
+    // True if the output refused bytes, e.g. because the buffer is full,
+    // or a container was closed that was nested too deeply to be tracked
+    boolean hasFailed();
+
+    virtual void whitespace(char c);
+
+    virtual void startDocument();
+
+    virtual void key(const char *key);
+
+    virtual void value(const char *value);
+
+    virtual void typedValue(const char *value, int type);
+
+    virtual void endArray();
+
+    virtual void endObject();
+
+    virtual void endDocument();
+
+    virtual void startArray();
+
+    virtual void startObject();
+
+    virtual void error( const char *message );
+};
@@ -0,0 +1,513 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+/**
+ * Host-side benchmarks for the optional parser features. They run on a
+ * synthetic document: one top-level array of small records.
+ *
+ *   make && ./benchmark [all|cbor|split|pool|columns|ring] [megabytes] [delay ns]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JsonStreamingParser.h"
+#include "JsonListener.h"
+#include "CborListener.h"
+#include "MsgPackListener.h"
+#include "JsonSplitter.h"
+#include "JsonColumnExtractor.h"
+#include "JsonEventRing.h"
+
+class NullListener: public JsonListener {
+  public:
+    virtual void whitespace(char c) {}
+    virtual void startDocument() {}
+    virtual void key(const char *key) {}
+    virtual void value(const char *value) {}
+    virtual void endArray() {}
+    virtual void endObject() {}
+    virtual void endDocument() {}
+    virtual void startArray() {}
+    virtual void startObject() {}
+    virtual void error( const char *message ) {
+      fprintf(stderr, "parse error: %s\n", message);
+    }
+};
+
+class CountingListener: public NullListener {
+  public:
+    long objects = 0;
+
+    virtual void endObject() {
+      objects++;
+    }
+};
+
+class CountingPrint: public Print {
+  public:
+    size_t bytes = 0;
+
+    virtual size_t write(uint8_t c) {
+      bytes++;
+      return 1;
+    }
+
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+      bytes += size;
+      return size;
+    }
+};
+
+static double now() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double megabytesPerSecond(size_t bytes, double seconds) {
+  return bytes / seconds / 1e6;
+}
+
+static std::string makeRecords(size_t bytes) {
+  std::string doc = "[";
+  char record[256];
+  for (long i = 0; doc.size() < bytes; i++) {
+    snprintf(record, sizeof(record),
+             "%s{\"id\": %ld, \"name\": \"user %ld\", \"score\": %ld.%ld, \"active\": %s, "
+             "\"tags\": [\"a\", \"b\"], \"pos\": {\"lat\": 47.%ld, \"lon\": -8.%ld}}",
+             i > 0 ? ",\n" : "", i, i, i % 1000, i % 10, i % 2 ? "true" : "false", i % 997, i % 991);
+    doc += record;
+  }
+  doc += "]";
+  return doc;
+}
+
+static double parseWith(const std::string &doc, JsonListener *listener) {
+  JsonStreamingParser parser;
+  parser.setListener(listener);
+  double start = now();
+  parser.parse(doc.data(), doc.size());
+  return now() - start;
+}
+
+static void benchmarkCbor(const std::string &doc) {
+  NullListener null;
+  double plain = parseWith(doc, &null);
+
+  CountingPrint output;
+  CborListener cbor(&output);
+  double transcoded = parseWith(doc, &cbor);
+
+  printf("cbor:    parse only %.1f MB/s, parse + CBOR %.1f MB/s, output %.1f%% of input\n",
+         megabytesPerSecond(doc.size(), plain), megabytesPerSecond(doc.size(), transcoded),
+         100.0 * output.bytes / doc.size());
+
+  // MessagePack needs to patch container sizes, so it goes to memory
+  const size_t chunkLength = 4096;
+  std::vector<uint8_t> storage(doc.size() + chunkLength);
+  std::vector<uint8_t*> chunks;
+  for (size_t i = 0; i + chunkLength <= storage.size(); i += chunkLength) {
+    chunks.push_back(&storage[i]);
+  }
+  MsgPackChunkedBuffer buffer(&chunks[0], chunks.size(), chunkLength);
+  MsgPackListener msgpack(&buffer);
+  double packed = parseWith(doc, &msgpack);
+
+  printf("msgpack: parse only %.1f MB/s, parse + MessagePack %.1f MB/s, output %.1f%% of input%s\n",
+         megabytesPerSecond(doc.size(), plain), megabytesPerSecond(doc.size(), packed),
+         100.0 * buffer.getLength() / doc.size(), msgpack.hasFailed() ? ", FAILED" : "");
+}
+
+// Runs work(i) for i in [0, count) spread over the given number of threads
+template<class Work> static void runOnThreads(int threads, int count, Work work) {
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.push_back(std::thread([&work, threads, count, t] {
+      for (int i = t; i < count; i += threads) {
+        work(i);
+      }
+    }));
+  }
+  for (size_t t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+}
+
+static void benchmarkSplit(const std::string &doc) {
+  int containers[] = { STACK_ARRAY };
+  double single = 0;
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    double start = now();
+    int segmentCount = threads * 4;
+    std::vector<JsonSegment> segments(segmentCount);
+    JsonSplitter::split(doc.data(), doc.size(), &segments[0], segmentCount);
+
+    // every step needs the previous one finished for all segments
+    runOnThreads(threads, segmentCount, [&segments](int i) {
+      JsonSplitter::scan(&segments[i]);
+    });
+    JsonSplitter::resolve(&segments[0], segmentCount);
+    runOnThreads(threads, segmentCount, [&segments](int i) {
+      JsonSplitter::findBoundary(&segments[i], 1);
+    });
+    std::vector<CountingListener> listeners(segmentCount);
+    std::vector<char> seamsValid(segmentCount);
+    runOnThreads(threads, segmentCount, [&](int i) {
+      JsonStreamingParser parser;
+      parser.setListener(&listeners[i]);
+      seamsValid[i] = JsonSplitter::parseSegment(&parser, &segments[0], i, segmentCount, containers, 1);
+    });
+    double elapsed = now() - start;
+
+    long objects = 0;
+    int invalid = 0;
+    for (int i = 0; i < segmentCount; i++) {
+      objects += listeners[i].objects;
+      invalid += !seamsValid[i];
+    }
+    if (threads == 1) {
+      single = elapsed;
+    }
+    printf("split:   %d thread(s) %.1f MB/s, speedup %.2fx, %ld objects, %d invalid seams\n",
+           threads, megabytesPerSecond(doc.size(), elapsed), single / elapsed, objects, invalid);
+  }
+}
+
+// Feeds every stream its document in chunks of chunkLength bytes, one
+// chunk per stream in turn, to simulate many slow connections. The first
+// chunk of each stream is shorter by a varying amount so that the streams
+// do not all reach token boundaries at the same time.
+template<class Parser>
+static void feedInterleaved(std::vector<Parser*> &parsers, const std::vector<std::string> &docs,
+                            size_t chunkLength, JsonBufferPool *pool, int *maxBlocksInUse) {
+  size_t streamCount = parsers.size();
+  std::vector<size_t> positions(streamCount, 0);
+  size_t active = streamCount;
+  for (int round = 0; active > 0; round++) {
+    active = 0;
+    for (size_t i = 0; i < streamCount; i++) {
+      const std::string &doc = docs[i % docs.size()];
+      size_t length = round == 0 ? 1 + i % chunkLength : chunkLength;
+      if (positions[i] < doc.size()) {
+        length = std::min(length, doc.size() - positions[i]);
+        parsers[i]->parse(doc.data() + positions[i], length);
+        positions[i] += length;
+        active++;
+      }
+    }
+    if (pool != NULL) {
+      *maxBlocksInUse = std::max(*maxBlocksInUse, (int) streamCount - pool->getFreeBlocks());
+    }
+  }
+}
+
+// The members of JsonStreamingParser before pooling was added, to compare
+// the memory per stream with
+struct BaselineParser {
+  int state;
+  int stack[20];
+  int stackPos;
+  JsonListener* myListener;
+  boolean doEmitWhitespace;
+  char buffer[BUFFER_MAX_LENGTH];
+  int bufferPos;
+  char unicodeEscapeBuffer[10];
+  int unicodeEscapeBufferPos;
+  char unicodeBuffer[10];
+  int unicodeBufferPos;
+  int characterCounter;
+  int unicodeHighSurrogate;
+  char errorMessage[128];
+};
+
+static void benchmarkPool() {
+  const int streamCount = 100000;
+  const int blockLength = 64;
+  const size_t chunkLength = 16;
+
+  // documents of different lengths so the streams do not run in lockstep
+  std::vector<std::string> docs;
+  size_t totalBytes = 0;
+  for (int d = 0; d < 7; d++) {
+    docs.push_back(makeRecords(200 + d * 60));
+  }
+  for (int i = 0; i < streamCount; i++) {
+    totalBytes += docs[i % docs.size()].size();
+  }
+  NullListener listener;
+
+  std::vector<JsonStreamingParser*> parsers;
+  for (int i = 0; i < streamCount; i++) {
+    parsers.push_back(new JsonStreamingParser());
+    parsers.back()->setListener(&listener);
+  }
+  double start = now();
+  feedInterleaved(parsers, docs, chunkLength, NULL, NULL);
+  double owned = now() - start;
+  for (int i = 0; i < streamCount; i++) {
+    delete parsers[i];
+  }
+
+  // the scratch buffer plus one side block per stream so the pool never
+  // runs dry; the peak shows how many are actually needed
+  std::vector<char> storage((size_t) (streamCount + 1) * blockLength);
+  JsonBufferPool pool(&storage[0], blockLength, streamCount + 1);
+  std::vector<JsonPooledParser*> pooledParsers;
+  for (int i = 0; i < streamCount; i++) {
+    pooledParsers.push_back(new JsonPooledParser(&pool));
+    pooledParsers.back()->setListener(&listener);
+  }
+  int maxBlocksInUse = 0;
+  start = now();
+  feedInterleaved(pooledParsers, docs, chunkLength, &pool, &maxBlocksInUse);
+  double pooled = now() - start;
+  for (int i = 0; i < streamCount; i++) {
+    delete pooledParsers[i];
+  }
+
+  size_t ownedPerStream = sizeof(JsonStreamingParser);
+  double pooledPerStream = sizeof(JsonPooledParser) + (double) (maxBlocksInUse + 1) * blockLength / streamCount;
+  printf("pool:    %d streams, %d byte chunks, baseline parser %d bytes per stream\n",
+         streamCount, (int) chunkLength, (int) sizeof(BaselineParser));
+  printf("pool:    own buffer %.1f MB/s, %d bytes per stream\n",
+         megabytesPerSecond(totalBytes, owned), (int) ownedPerStream);
+  printf("pool:    pooled     %.1f MB/s, %d bytes per idle stream (%.1fx less than baseline), "
+         "%.1f bytes per stream at peak (%d of %d side blocks of %d bytes in use)\n",
+         megabytesPerSecond(totalBytes, pooled), (int) sizeof(JsonPooledParser),
+         (double) sizeof(BaselineParser) / sizeof(JsonPooledParser), pooledPerStream,
+         maxBlocksInUse, streamCount, blockLength);
+}
+
+#define BATCH_SIZE 65536
+
+struct Row {
+  long id;
+  char name[16];
+  double score;
+  boolean active;
+  double lat;
+  double lon;
+};
+
+// What the column extractor replaces: a listener that looks every key up in
+// a map and fills one row struct per record
+class RowListener: public NullListener {
+  private:
+    std::map<std::string, int> fields;
+    std::string prefix;
+    int field = -1;
+    int depth = 0;
+
+  public:
+    std::vector<Row> rows;
+    long batches = 0;
+
+    RowListener() {
+      fields["id"] = 0;
+      fields["name"] = 1;
+      fields["score"] = 2;
+      fields["active"] = 3;
+      fields["pos.lat"] = 4;
+      fields["pos.lon"] = 5;
+      rows.reserve(BATCH_SIZE);
+    }
+
+    virtual void startObject() {
+      depth++;
+      if (depth == 2) {
+        rows.push_back(Row());
+        prefix.clear();
+      } else if (depth == 3) {
+        prefix = "pos.";
+      }
+    }
+
+    virtual void endObject() {
+      depth--;
+      if (depth == 1 && rows.size() == BATCH_SIZE) {
+        batches++;
+        rows.clear();
+      }
+      prefix.clear();
+    }
+
+    virtual void startArray() {
+      depth++;
+    }
+
+    virtual void endArray() {
+      depth--;
+    }
+
+    virtual void key(const char *key) {
+      std::map<std::string, int>::iterator found = fields.find(prefix + key);
+      field = found == fields.end() ? -1 : found->second;
+    }
+
+    virtual void value(const char *value) {
+      if (rows.empty() || depth > 3) {
+        return;
+      }
+      Row &row = rows.back();
+      switch (field) {
+        case 0: row.id = strtol(value, NULL, 10); break;
+        case 1: strncpy(row.name, value, sizeof(row.name) - 1); row.name[sizeof(row.name) - 1] = '\0'; break;
+        case 2: row.score = strtod(value, NULL); break;
+        case 3: row.active = strcmp(value, "true") == 0; break;
+        case 4: row.lat = strtod(value, NULL); break;
+        case 5: row.lon = strtod(value, NULL); break;
+      }
+      field = -1;
+    }
+};
+
+static void countRows(JsonColumn columns[], int columnCount, int rows, void *context) {
+  *(long *) context += rows;
+}
+
+static void benchmarkColumns(const std::string &doc) {
+  RowListener rowListener;
+  double rowWise = parseWith(doc, &rowListener);
+
+  std::vector<long> ids(BATCH_SIZE);
+  std::vector<char> names(BATCH_SIZE * 16);
+  std::vector<double> scores(BATCH_SIZE), lats(BATCH_SIZE), lons(BATCH_SIZE);
+  // std::vector<bool> is packed into bits, the column needs real booleans
+  boolean *active = new boolean[BATCH_SIZE];
+  std::vector<std::vector<uint8_t> > present(6, std::vector<uint8_t>((BATCH_SIZE + 7) / 8));
+  JsonColumn columns[] = {
+    { "id", COLUMN_TYPE_LONG, &ids[0], 0, &present[0][0] },
+    { "name", COLUMN_TYPE_STRING, &names[0], 16, &present[1][0] },
+    { "score", COLUMN_TYPE_DOUBLE, &scores[0], 0, &present[2][0] },
+    { "active", COLUMN_TYPE_BOOLEAN, active, 0, &present[3][0] },
+    { "pos.lat", COLUMN_TYPE_DOUBLE, &lats[0], 0, &present[4][0] },
+    { "pos.lon", COLUMN_TYPE_DOUBLE, &lons[0], 0, &present[5][0] },
+  };
+  long columnRows = 0;
+  JsonColumnExtractor extractor(columns, 6, BATCH_SIZE, countRows, &columnRows);
+  double columnar = parseWith(doc, &extractor);
+  delete[] active;
+
+  NullListener null;
+  double plain = parseWith(doc, &null);
+
+  printf("columns: parse only %.1f MB/s, row-wise listener %.1f MB/s, column extractor %.1f MB/s, %ld/%ld rows\n",
+         megabytesPerSecond(doc.size(), plain), megabytesPerSecond(doc.size(), rowWise),
+         megabytesPerSecond(doc.size(), columnar),
+         rowListener.batches * BATCH_SIZE + (long) rowListener.rows.size(), columnRows);
+}
+
+// Stands in for a listener doing real work per event: busy-waits for the
+// given time and hashes every event in order, so that direct and replayed
+// delivery can be compared
+class SlowListener: public JsonListener {
+  private:
+    std::chrono::nanoseconds delay;
+
+    void event(uint8_t type, const char *data) {
+      if (delay.count() > 0) {
+        std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now() + delay;
+        while (std::chrono::steady_clock::now() < until) {
+        }
+      }
+      checksum = (checksum ^ type) * 1099511628211ULL;
+      for (; data != NULL && *data != '\0'; data++) {
+        checksum = (checksum ^ (uint8_t) *data) * 1099511628211ULL;
+      }
+      events++;
+    }
+
+  public:
+    uint64_t checksum = 14695981039346656037ULL;
+    long events = 0;
+
+    SlowListener(long delayNanoseconds): delay(delayNanoseconds) {}
+
+    virtual void whitespace(char c) {}
+    virtual void startDocument() { event(EVENT_START_DOCUMENT, NULL); }
+    virtual void key(const char *key) { event(EVENT_KEY, key); }
+    virtual void value(const char *value) { event(EVENT_VALUE, value); }
+    virtual void endArray() { event(EVENT_END_ARRAY, NULL); }
+    virtual void endObject() { event(EVENT_END_OBJECT, NULL); }
+    virtual void endDocument() { event(EVENT_END_DOCUMENT, NULL); }
+    virtual void startArray() { event(EVENT_START_ARRAY, NULL); }
+    virtual void startObject() { event(EVENT_START_OBJECT, NULL); }
+    virtual void error( const char *message ) {
+      fprintf(stderr, "parse error: %s\n", message);
+      event(EVENT_ERROR, message);
+    }
+};
+
+static void benchmarkRing(const std::string &doc, long delay) {
+  SlowListener direct(delay);
+  double directTime = parseWith(doc, &direct);
+
+  std::vector<uint8_t> storage(65536);
+  JsonEventRing ring(&storage[0], storage.size());
+  SlowListener replayed(delay);
+  double start = now();
+  std::thread consumer([&] { ring.replayAll(&replayed); });
+  parseWith(doc, &ring);
+  consumer.join();
+  double ringTime = now() - start;
+
+  printf("ring: %ld ns/event, direct %.1f MB/s, through ring %.1f MB/s (%.2fx), %ld events, checksums %s\n",
+         delay, megabytesPerSecond(doc.size(), directTime), megabytesPerSecond(doc.size(), ringTime),
+         directTime / ringTime, direct.events,
+         direct.events == replayed.events && direct.checksum == replayed.checksum ? "match" : "DIFFER");
+}
+
+int main(int argc, char **argv) {
+  std::string which = argc > 1 ? argv[1] : "all";
+  size_t megabytes = argc > 2 ? atol(argv[2]) : 16;
+  std::string doc = makeRecords(megabytes * 1000000);
+  printf("input: %.1f MB\n", doc.size() / 1e6);
+
+  if (which == "all" || which == "cbor") {
+    benchmarkCbor(doc);
+  }
+  if (which == "all" || which == "split") {
+    benchmarkSplit(doc);
+  }
+  if (which == "all" || which == "pool") {
+    benchmarkPool();
+  }
+  if (which == "all" || which == "columns") {
+    benchmarkColumns(doc);
+  }
+  if (which == "all" || which == "ring") {
+    if (argc > 3) {
+      benchmarkRing(doc, atol(argv[3]));
+    } else {
+      benchmarkRing(doc, 0);
+      benchmarkRing(doc, 100);
+      benchmarkRing(doc, 1000);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,152 @@
+/**The MIT License (MIT)
+
+Copyright (c) 2015 by Daniel Eichhorn
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+See more at http://blog.squix.ch and https://github.com/squix78/json-streaming-parser
+*/
+
+/**
+ * Host-side checks for the decoding of \u escapes and the optional UTF-8
+ * validation. Exits with a non-zero status if any check fails.
+ *
+ *   make
+ */
+
+#include <string>
+
+#include "JsonStreamingParser.h"
+#include "JsonListener.h"
+
+// Remembers the last string value and whether an error was reported
+class StringListener: public JsonListener {
+  public:
+    std::string last;
+    boolean failed = false;
+
+    virtual void whitespace(char c) {}
+    virtual void startDocument() {}
+    virtual void key(const char *key) {}
+    virtual void value(const char *value) {
+      last = value;
+    }
+    virtual void endArray() {}
+    virtual void endObject() {}
+    virtual void endDocument() {}
+    virtual void startArray() {}
+    virtual void startObject() {}
+    virtual void error( const char *message ) {
+      failed = true;
+    }
+};
+
+static int failures = 0;
+
+static std::string hex(const std::string &s) {
+  std::string result;
+  char digits[4];
+  for (size_t i = 0; i < s.size(); i++) {
+    snprintf(digits, sizeof(digits), "%02X ", (uint8_t) s[i]);
+    result += digits;
+  }
+  return result;
+}
+
+// Parses ["<string>"] once as a whole chunk and once character by
+// character, and compares the value with the expected UTF-8 bytes
+static void check(const char *string, const std::string &expected, boolean validate = false) {
+  std::string doc = std::string("[\"") + string + "\"]";
+  for (int byChar = 0; byChar < 2; byChar++) {
+    StringListener listener;
+    JsonStreamingParser parser;
+    parser.setListener(&listener);
+    parser.setValidateUtf8(validate);
+    if (byChar) {
+      for (size_t i = 0; i < doc.size(); i++) {
+        parser.parse(doc[i]);
+      }
+    } else {
+      parser.parse(doc.data(), doc.size());
+    }
+    if (listener.failed || listener.last != expected) {
+      printf("FAIL %s%s: got %s%s, expected %s\n", string, byChar ? " (by char)" : "",
+             hex(listener.last).c_str(), listener.failed ? "and an error" : "", hex(expected).c_str());
+      failures++;
+    }
+  }
+}
+
+// Checks that the parser reports an error for the string
+static void checkRejected(const char *string) {
+  std::string doc = std::string("[\"") + string + "\"]";
+  StringListener listener;
+  JsonStreamingParser parser;
+  parser.setListener(&listener);
+  parser.setValidateUtf8(true);
+  parser.parse(doc.data(), doc.size());
+  if (!listener.failed) {
+    printf("FAIL %s: accepted as %s\n", hex(string).c_str(), hex(listener.last).c_str());
+    failures++;
+  }
+}
+
+int main() {
+  // escapes
+  check("\\u0041", "A");
+  check("\\u00e9", "\xC3\xA9");
+  check("\\u00E9", "\xC3\xA9");
+  check("\\u20AC", "\xE2\x82\xAC");
+  check("\\uFFFF", "\xEF\xBF\xBF");
+  check("a\\\"b\\\\c\\/d\\n", "a\"b\\c/d\n");
+
+  // surrogate pairs
+  check("\\uD83D\\uDE00", "\xF0\x9F\x98\x80");
+  check("x\\ud834\\udd1ey", "x\xF0\x9D\x84\x9Ey");
+  check("\\uDBFF\\uDFFF", "\xF4\x8F\xBF\xBF");
+
+  // unpaired surrogates become U+FFFD
+  check("\\uDE00", "\xEF\xBF\xBD");
+  check("\\uD83D", "\xEF\xBF\xBD");
+  check("\\uD83Dx", "\xEF\xBF\xBDx");
+  check("\\uD83D\\n", "\xEF\xBF\xBD\n");
+  check("\\uD83D\\u0041", "\xEF\xBF\xBD" "A");
+  check("\\uD83D\\uD83D\\uDE00", "\xEF\xBF\xBD\xF0\x9F\x98\x80");
+
+  // raw UTF-8 is passed through, with and without validation
+  check("\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+  check("\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", true);
+  check("\xFF", "\xFF");
+
+  // malformed UTF-8 is rejected when validating
+  checkRejected("\xC3\x28");
+  checkRejected("\xC0\xAF");
+  checkRejected("\xE0\x80\xAF");
+  checkRejected("\xED\xA0\x80");
+  checkRejected("\xF4\x90\x80\x80");
+  checkRejected("\xFF");
+  checkRejected("\xE2\x82");
+
+  if (failures > 0) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}